@@ -0,0 +1,72 @@
+/* Copyright (c) 2019 - 2021 Marcelo Zimbres Silva (mzimbres at gmail dot com)
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#include <thread>
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+
+#include "memory_stream.hpp"
+
+// Reads replies to GET of large values over a local socket into a
+// response_blob_string, as a blob cache would.
+
+using namespace aedis;
+using local = net::local::stream_protocol;
+using socket_type = net::use_awaitable_t<>::as_default_on_t<local::socket>;
+
+auto const total_bytes = std::size_t {1} << 30;
+
+double run(std::size_t size)
+{
+   auto const count = total_bytes / size;
+   std::string const reply =
+      "$" + std::to_string(size) + "\r\n" + std::string(size, 'x') + "\r\n";
+
+   net::io_context ioc;
+   socket_type client {ioc};
+   local::socket server {ioc};
+   net::local::connect_pair(client, server);
+
+   std::thread t {[&]() {
+      for (std::size_t i = 0; i < count; ++i)
+	 net::write(server, net::buffer(reply));
+   }};
+
+   co_spawn(ioc, [&]() -> net::awaitable<void> {
+      resp::read_buffer buffer;
+      resp::response_blob_string res;
+      for (std::size_t i = 0; i < count; ++i) {
+	 co_await resp::async_read(client, buffer, res);
+	 if (std::size(res.result) != size)
+	    std::cerr << "Unexpected size" << std::endl;
+      }
+   }, net::detached);
+
+   auto const begin = std::chrono::steady_clock::now();
+   ioc.run();
+   std::chrono::duration<double> const d =
+      std::chrono::steady_clock::now() - begin;
+
+   t.join();
+   return total_bytes / d.count() / (1 << 20);
+}
+
+int main()
+{
+   std::cout
+      << std::left << std::setw(16) << "value size"
+      << std::left << std::setw(16) << "MB/s"
+      << std::endl;
+
+   for (std::size_t size : {1024, 100 * 1024, 1024 * 1024}) {
+      std::cout
+	 << std::left << std::setw(16) << size
+	 << std::left << std::setw(16) << run(size)
+	 << std::endl;
+   }
+}
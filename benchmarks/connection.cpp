@@ -0,0 +1,138 @@
+/* Copyright (c) 2019 - 2021 Marcelo Zimbres Silva (mzimbres at gmail dot com)
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#include <thread>
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+
+#include "memory_stream.hpp"
+
+// Sends batches of GETs to a server that answers each read after a
+// simulated round trip. async_read_responses writes a batch once the
+// previous one was answered, the connection keeps writing while
+// replies are outstanding.
+
+using namespace aedis;
+using local = net::local::stream_protocol;
+using socket_type = net::use_awaitable_t<>::as_default_on_t<local::socket>;
+
+auto const batches = 500;
+auto const batch_size = 10;
+auto const total = batches * batch_size;
+auto const rtt = std::chrono::microseconds {200};
+
+// Replies +OK to every GET after sleeping rtt on each read.
+void serve(local::socket& s, std::size_t cmd_size)
+{
+   std::vector<char> buf(1 << 20);
+   std::string replies;
+   std::size_t bytes = 0;
+   boost::system::error_code ec;
+   for (auto answered = 0; answered < total && !ec;) {
+      bytes += s.read_some(net::buffer(buf), ec);
+      auto const n = static_cast<int>(bytes / cmd_size) - answered;
+      std::this_thread::sleep_for(rtt);
+      replies.clear();
+      for (auto i = 0; i < n; ++i)
+	 replies += "+OK\r\n";
+      net::write(s, net::buffer(replies), ec);
+      answered += n;
+   }
+}
+
+struct receiver : resp::receiver_base<resp::event> {
+   using event_type = resp::event;
+   socket_type* socket = nullptr;
+   int received = 0;
+
+   void receive(resp::response_id<event_type> const&, std::vector<std::string>) override
+   {
+      if (++received == total)
+	 socket->close();
+   }
+};
+
+void print(std::string const& name, double ms)
+{
+   std::cout
+      << std::left << std::setw(24) << name
+      << std::left << std::setw(16) << ms
+      << std::left << std::setw(16) << total / ms
+      << std::endl;
+}
+
+template <class F>
+double run(F f)
+{
+   net::io_context ioc;
+   socket_type client {ioc};
+   local::socket server {ioc};
+   net::local::connect_pair(client, server);
+
+   resp::request probe;
+   probe.get("key");
+   std::thread t {[&]() { serve(server, std::size(probe.payload)); }};
+
+   receiver recv;
+   recv.socket = &client;
+   co_spawn(ioc, f(client, recv), net::detached);
+
+   auto const begin = std::chrono::steady_clock::now();
+   ioc.run();
+   std::chrono::duration<double, std::milli> const d =
+      std::chrono::steady_clock::now() - begin;
+
+   t.join();
+   return d.count();
+}
+
+int main()
+{
+   std::cout
+      << std::left << std::setw(24) << "client"
+      << std::left << std::setw(16) << "ms"
+      << std::left << std::setw(16) << "commands/ms"
+      << std::endl;
+
+   auto const t1 = run([](socket_type& s, receiver& recv) -> net::awaitable<void> {
+      for (auto i = 0; i < batches; ++i) {
+	 resp::request req;
+	 for (auto j = 0; j < batch_size; ++j)
+	    req.get("key");
+	 recv.add(std::move(req));
+      }
+
+      try {
+	 co_await resp::async_write(s, recv.reqs.front(), net::use_awaitable);
+	 co_await resp::async_read_responses(s, recv);
+      } catch (...) {
+      }
+   });
+   print("async_read_responses", t1);
+
+   auto const t2 = run([](socket_type& s, receiver& recv) -> net::awaitable<void> {
+      auto ex = co_await net::this_coro::executor;
+      resp::connection<socket_type> conn {s};
+      bool done = false;
+      co_spawn(ex, conn.run(recv), [&](std::exception_ptr) { done = true; });
+
+      // A batch per turn of the event loop, as if issued by
+      // independent coroutines.
+      for (auto i = 0; i < batches; ++i) {
+	 conn.enqueue([](auto& req) {
+	    for (auto j = 0; j < batch_size; ++j)
+	       req.get("key");
+	 });
+	 co_await net::post(ex, net::use_awaitable);
+      }
+
+      while (!done)
+	 co_await net::post(ex, net::use_awaitable);
+   });
+   print("connection", t2);
+}
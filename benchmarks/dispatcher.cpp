@@ -0,0 +1,74 @@
+/* Copyright (c) 2019 - 2021 Marcelo Zimbres Silva (mzimbres at gmail dot com)
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#include <iostream>
+#include <iomanip>
+
+#include "memory_stream.hpp"
+
+// Messages per second delivered to an increasing number of handlers of
+// the same channel, among 1000 other channels and a few patterns that
+// do not match. The dispatcher shares one buffer among the handlers,
+// the baseline passes each handler its own copy of the push as a
+// receiver would.
+
+using namespace aedis;
+
+auto const channels = 1000;
+auto const messages = 20000;
+
+using copy_handler = std::function<void(std::vector<std::string>)>;
+
+int main()
+{
+   std::cout
+      << std::left << std::setw(16) << "fan-out"
+      << std::left << std::setw(16) << "msgs/s"
+      << std::left << std::setw(16) << "msgs/s (copy)"
+      << std::endl;
+
+   std::vector<std::string> const push
+      {"message", "channel:0", std::string(256, 'x')};
+
+   for (auto fanout : {1, 10, 100, 1000}) {
+      std::size_t bytes = 0;
+
+      resp::dispatcher disp;
+      for (auto i = 1; i < channels; ++i)
+	 disp.subscribe("channel:" + std::to_string(i), [](auto const&) { });
+      for (auto i = 0; i < 8; ++i)
+	 disp.psubscribe("other:" + std::to_string(i) + ":*", [](auto const&) { });
+      for (auto i = 0; i < fanout; ++i)
+	 disp.subscribe("channel:0", [&](auto const& msg) { bytes += std::size(msg.payload); });
+
+      auto const t1 = measure(messages, [&]() {
+	 auto v = push;
+	 disp.dispatch(v);
+      });
+
+      std::unordered_map<std::string, std::vector<copy_handler>> copies;
+      for (auto i = 1; i < channels; ++i)
+	 copies["channel:" + std::to_string(i)].push_back([](auto) { });
+      for (auto i = 0; i < fanout; ++i)
+	 copies["channel:0"].push_back([&](auto v) { bytes += std::size(v.back()); });
+
+      auto const t2 = measure(messages, [&]() {
+	 auto v = push;
+	 for (auto const& h : copies[v[1]])
+	    h(v);
+      });
+
+      std::cout
+	 << std::left << std::setw(16) << fanout
+	 << std::left << std::setw(16) << static_cast<long>(1e6 / t1)
+	 << std::left << std::setw(16) << static_cast<long>(1e6 / t2)
+	 << std::endl;
+
+      if (bytes == 0)
+	 return 1;
+   }
+}
@@ -0,0 +1,125 @@
+/* Copyright (c) 2019 - 2021 Marcelo Zimbres Silva (mzimbres at gmail dot com)
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#include <new>
+#include <cstddef>
+#include <cstdlib>
+#include <algorithm>
+#include <iostream>
+#include <iomanip>
+
+#include "memory_stream.hpp"
+
+// Decodes HGETALL replies of a struct with nine string fields, as in
+// examples/async_all_hashes.cpp, into a vector of strings per object
+// and into a reused response_struct.
+
+using namespace aedis;
+
+// Calls to the global operator new. Every replaceable form is defined
+// so that all memory released with std::free comes from here.
+static std::size_t allocations = 0;
+
+static void* counted_alloc(std::size_t n, std::size_t align = alignof(std::max_align_t))
+{
+   ++allocations;
+   n = std::max<std::size_t>(n, 1);
+   auto* p = align <= alignof(std::max_align_t)
+      ? std::malloc(n)
+      : std::aligned_alloc(align, (n + align - 1) / align * align);
+   if (!p)
+      throw std::bad_alloc {};
+   return p;
+}
+
+void* operator new(std::size_t n) { return counted_alloc(n); }
+void* operator new[](std::size_t n) { return counted_alloc(n); }
+void* operator new(std::size_t n, std::align_val_t a) { return counted_alloc(n, static_cast<std::size_t>(a)); }
+void* operator new[](std::size_t n, std::align_val_t a) { return counted_alloc(n, static_cast<std::size_t>(a)); }
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+void operator delete(void* p, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::align_val_t) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t, std::align_val_t) noexcept { std::free(p); }
+
+struct foo {
+   std::string id;
+   std::string from;
+   std::string nick;
+   std::string avatar;
+   std::string description;
+   std::string location;
+   std::string product;
+   std::string details;
+   std::string values;
+};
+
+template <>
+struct resp::struct_fields<foo> {
+   static constexpr auto value = std::make_tuple(
+      resp::field {"id", &foo::id},
+      resp::field {"from", &foo::from},
+      resp::field {"nick", &foo::nick},
+      resp::field {"avatar", &foo::avatar},
+      resp::field {"description", &foo::description},
+      resp::field {"location", &foo::location},
+      resp::field {"product", &foo::product},
+      resp::field {"details", &foo::details},
+      resp::field {"values", &foo::values});
+};
+
+template <class F>
+void run(std::string const& name, std::string const& payload, int n, F f)
+{
+   memory_stream stream {&payload};
+   resp::read_buffer buffer;
+   allocations = 0;
+   auto const t = measure(1, [&]() { f(stream, buffer); });
+
+   std::cout
+      << std::left << std::setw(16) << name
+      << std::left << std::setw(16) << 1000 * t / n
+      << std::left << std::setw(16) << double(allocations) / n
+      << std::endl;
+}
+
+int main()
+{
+   auto const n = 20000;
+   std::string payload;
+   for (auto i = 0; i < n; ++i) {
+      payload += "%9\r\n";
+      for (auto name : resp::field_names<foo>()) {
+	 payload += "$" + std::to_string(std::size(name)) + "\r\n";
+	 payload += std::string {name} + "\r\n";
+	 payload += "$34\r\n" + std::string(34, 'a') + "\r\n";
+      }
+   }
+
+   std::cout
+      << std::left << std::setw(16) << "response"
+      << std::left << std::setw(16) << "ns/object"
+      << std::left << std::setw(16) << "allocs/object"
+      << std::endl;
+
+   run("array<string>", payload, n, [&](auto& stream, auto& buffer) {
+      for (auto i = 0; i < n; ++i) {
+	 resp::response_array<std::string> res;
+	 resp::read(stream, buffer, res);
+      }
+   });
+
+   run("struct", payload, n, [&](auto& stream, auto& buffer) {
+      resp::response_struct<foo> res;
+      for (auto i = 0; i < n; ++i)
+	 resp::read(stream, buffer, res);
+   });
+}
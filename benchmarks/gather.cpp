@@ -0,0 +1,79 @@
+/* Copyright (c) 2019 - 2021 Marcelo Zimbres Silva (mzimbres at gmail dot com)
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#include <thread>
+#include <iostream>
+#include <iomanip>
+
+#include "memory_stream.hpp"
+
+// Measures building and writing requests with large values to a local
+// socket, copying the values into the payload or referring to them.
+
+using namespace aedis;
+using local = net::local::stream_protocol;
+
+void print(std::string const& name, double us, std::size_t payload)
+{
+   std::cout
+      << std::left << std::setw(24) << name
+      << std::left << std::setw(16) << us / 1000
+      << std::left << std::setw(16) << payload
+      << std::endl;
+}
+
+int main()
+{
+   std::cout
+      << std::left << std::setw(24) << "request"
+      << std::left << std::setw(16) << "ms"
+      << std::left << std::setw(16) << "payload bytes"
+      << std::endl;
+
+   net::io_context ioc;
+   local::socket writer {ioc};
+   local::socket reader {ioc};
+   net::local::connect_pair(writer, reader);
+
+   std::thread drain {[&]() {
+      std::vector<char> buf(1 << 20);
+      boost::system::error_code ec;
+      while (!ec)
+	 reader.read_some(net::buffer(buf), ec);
+   }};
+
+   auto const n = 64;
+   auto const runs = 10;
+   std::string const value(1 << 20, 'x');
+
+   {
+      std::size_t payload = 0;
+      auto const t = measure(runs, [&]() {
+	 resp::request req;
+	 for (auto i = 0; i < n; ++i)
+	    req.set("key", {value});
+	 resp::write(writer, req);
+	 payload = std::size(req.payload);
+      });
+      print("set (copy)", t, payload);
+   }
+
+   {
+      std::size_t payload = 0;
+      auto const t = measure(runs, [&]() {
+	 resp::request req;
+	 for (auto i = 0; i < n; ++i)
+	    req.set("key", resp::borrow(value));
+	 resp::write(writer, req);
+	 payload = std::size(req.payload);
+      });
+      print("set (borrow)", t, payload);
+   }
+
+   writer.shutdown(local::socket::shutdown_send);
+   drain.join();
+}
@@ -0,0 +1,59 @@
+/* Copyright (c) 2019 - 2021 Marcelo Zimbres Silva (mzimbres at gmail dot com)
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <string>
+#include <algorithm>
+
+#include <aedis/aedis.hpp>
+
+namespace aedis {
+
+// A synchronous stream that serves a payload from memory, at most
+// max_read bytes per read_some to mimic a socket.
+struct memory_stream {
+   std::string const* payload;
+   std::size_t max_read = 65536;
+   std::size_t pos = 0;
+
+   template <class MutableBufferSequence>
+   std::size_t
+   read_some(
+      MutableBufferSequence const& buffers,
+      boost::system::error_code& ec)
+   {
+      if (pos == std::size(*payload)) {
+	 ec = net::error::eof;
+	 return 0;
+      }
+
+      auto const n =
+	 std::min({ net::buffer_size(buffers)
+		  , std::size(*payload) - pos
+		  , max_read});
+
+      net::buffer_copy(buffers, net::buffer(payload->data() + pos, n));
+      pos += n;
+      return n;
+   }
+};
+
+// Returns the average time in microseconds taken by f over n runs.
+template <class F>
+double measure(int n, F f)
+{
+   auto const begin = std::chrono::steady_clock::now();
+   for (auto i = 0; i < n; ++i)
+      f();
+   auto const end = std::chrono::steady_clock::now();
+   std::chrono::duration<double, std::micro> const d = end - begin;
+   return d.count() / n;
+}
+
+} // aedis
@@ -0,0 +1,80 @@
+/* Copyright (c) 2019 - 2021 Marcelo Zimbres Silva (mzimbres at gmail dot com)
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#include <vector>
+#include <iostream>
+#include <iomanip>
+
+#include "memory_stream.hpp"
+
+// Compares the integer decoders on numbers with typical RESP length
+// sizes, i.e. 1 to 7 digits.
+
+using namespace aedis;
+
+// The per digit loop the parser used before.
+long long digit_loop(char const* p, char const* last)
+{
+   long long len = 0;
+   while (p != last) {
+       len = (10 * len) + (*p - '0');
+       p++;
+   }
+   return len;
+}
+
+int main()
+{
+   std::cout
+      << std::left << std::setw(8) << "digits"
+      << std::left << std::setw(16) << "loop (ns)"
+      << std::left << std::setw(16) << "from_chars (ns)"
+      << std::left << std::setw(16) << "parse_integer (ns)"
+      << std::endl;
+
+   auto const n = 20000000;
+   long long sink = 0;
+   for (auto digits = 1; digits <= 7; ++digits) {
+      std::vector<std::string> v;
+      for (auto i = 0; i < 1000; ++i) {
+	 std::string s(digits, '0');
+	 for (auto& c : s)
+	    c = '1' + (i * 7 + (&c - s.data())) % 9;
+	 v.push_back(s);
+      }
+
+      auto const a = measure(n / 1000, [&]() {
+	 for (auto const& s : v)
+	    sink += digit_loop(s.data(), s.data() + s.size());
+      });
+
+      auto const b = measure(n / 1000, [&]() {
+	 for (auto const& s : v) {
+	    long long r = 0;
+	    std::from_chars(s.data(), s.data() + s.size(), r);
+	    sink += r;
+	 }
+      });
+
+      auto const c = measure(n / 1000, [&]() {
+	 for (auto const& s : v) {
+	    long long r = 0;
+	    resp::parse_integer(s.data(), s.data() + s.size(), r);
+	    sink += r;
+	 }
+      });
+
+      std::cout
+	 << std::left << std::setw(8) << digits
+	 << std::left << std::setw(16) << a
+	 << std::left << std::setw(16) << b
+	 << std::left << std::setw(16) << c
+	 << std::endl;
+   }
+
+   return sink == 0;
+}
@@ -0,0 +1,201 @@
+/* Copyright (c) 2019 - 2021 Marcelo Zimbres Silva (mzimbres at gmail dot com)
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#include <iostream>
+#include <iomanip>
+
+#include "memory_stream.hpp"
+
+// Measures the parser alone on a pipeline of replies already in
+// memory, with the element types mixed so that dispatching on the
+// type byte is hard to predict.
+
+using namespace aedis;
+
+// Parses every reply in the payload and returns the number of them.
+template <class Response>
+int parse_all(std::string const& payload, Response& res)
+{
+   auto n = 0;
+   std::size_t i = 0;
+   while (i != std::size(payload)) {
+      resp::parser<Response> p {&res};
+      i += p.parse(payload.data() + i, std::size(payload) - i);
+      ++n;
+   }
+
+   return n;
+}
+
+// Ignores everything like response_ignore but declares the types it
+// supports, so that the parser is specialized on them.
+template <resp::type_set Types>
+struct response_typed : resp::response_ignore {
+   static constexpr resp::type_set supported_types = Types;
+};
+
+// The virtual base flat responses derived from before response_base
+// became a CRTP base, with the parser driving it through the base.
+struct virtual_base {
+   virtual void select_array(int n) { }
+   virtual void select_push(int n) { }
+   virtual void select_set(int n) { }
+   virtual void select_map(int n) { }
+   virtual void on_simple_string(std::string_view s) { }
+   virtual void on_simple_error(std::string_view s) { }
+   virtual void on_number(std::string_view s) { }
+   virtual void on_double(std::string_view s) { }
+   virtual void on_bool(std::string_view s) { }
+   virtual void on_big_number(std::string_view s) { }
+   virtual void on_null() { }
+   virtual void on_blob_error(std::string_view s = {}) { }
+   virtual void on_verbatim_string(std::string_view s = {}) { }
+   virtual void on_blob_string(std::string_view s = {}) { }
+   virtual void on_streamed_string_part(std::string_view s = {}) { }
+   virtual ~virtual_base() = default;
+
+   void pop() {}
+   void select_attribute(int n) { }
+};
+
+// response_array<T> on top of virtual_base.
+template <class T>
+struct virtual_array : virtual_base {
+   std::vector<T> result;
+
+   void select_array(int n) override { resp::reserve_more(result, n); }
+   void on_number(std::string_view s) override
+   {
+      T r;
+      resp::from_string_view(s, r);
+      result.emplace_back(std::move(r));
+   }
+};
+
+void print(std::string const& name, int elems, double us)
+{
+   std::cout
+      << std::left << std::setw(24) << name
+      << std::left << std::setw(16) << 1000 * us / elems
+      << std::endl;
+}
+
+int main()
+{
+   std::cout
+      << std::left << std::setw(24) << "payload"
+      << std::left << std::setw(16) << "ns/element"
+      << std::endl;
+
+   // The order of the types is fixed by a simple generator so that it
+   // is the same across runs but has no short period.
+   std::string const replies[] =
+      { "+OK\r\n"
+      , ":1234\r\n"
+      , "$5\r\nhello\r\n"
+      , "*2\r\n$1\r\na\r\n:2\r\n"
+      , "%1\r\n+key\r\n,3.14\r\n"
+      , "#t\r\n"
+      , "_\r\n"
+      , "-ERR x\r\n"
+      , "~2\r\n+a\r\n+b\r\n"
+      , "(12345678901234567890\r\n"
+      };
+
+   // Elements in each reply above, aggregates included.
+   int const elems[] = {1, 1, 1, 3, 3, 1, 1, 1, 3, 1};
+
+   std::string mixed;
+   auto mixed_elems = 0;
+   unsigned x = 1;
+   for (auto i = 0; i < 100000; ++i) {
+      x = x * 1103515245 + 12345;
+      auto const k = (x >> 16) % std::size(replies);
+      mixed += replies[k];
+      mixed_elems += elems[k];
+   }
+
+   std::string numbers;
+   for (auto i = 0; i < 100000; ++i)
+      numbers += ":" + std::to_string(i) + "\r\n";
+
+   // Replies nested deeper than the inline depth of the parser.
+   std::string deep;
+   for (auto i = 0; i < 10000; ++i) {
+      for (auto j = 0; j < 16; ++j)
+	 deep += "*1\r\n";
+      deep += ":1\r\n";
+   }
+
+   std::string array {"*100000\r\n"};
+   for (auto i = 0; i < 100000; ++i)
+      array += ":" + std::to_string(i) + "\r\n";
+
+   auto const runs = 20;
+
+   {
+      resp::response_ignore res;
+      auto const t = measure(runs, [&]() { parse_all(mixed, res); });
+      print("mixed (ignore)", mixed_elems, t);
+   }
+
+   // The same response with all types and with only those in the
+   // mixed pipeline, the parser compiles out the others.
+   {
+      response_typed<resp::all_types> res;
+      auto const t = measure(runs, [&]() { parse_all(mixed, res); });
+      print("mixed (all types)", mixed_elems, t);
+   }
+
+   {
+      using resp::type;
+      response_typed<resp::make_type_set(
+	 type::simple_string, type::number, type::blob_string,
+	 type::array, type::map, type::double_type, type::boolean,
+	 type::null, type::simple_error, type::set,
+	 type::big_number)> res;
+      auto const t = measure(runs, [&]() { parse_all(mixed, res); });
+      print("mixed (specialized)", mixed_elems, t);
+   }
+
+   {
+      resp::response_ignore res;
+      auto const t = measure(runs, [&]() { parse_all(numbers, res); });
+      print("numbers (ignore)", 100000, t);
+   }
+
+   {
+      resp::response_number<long long> res;
+      auto const t = measure(runs, [&]() { parse_all(numbers, res); });
+      print("numbers (number)", 100000, t);
+   }
+
+   {
+      resp::response_array<int> res;
+      auto const t = measure(runs, [&]() {
+	 parse_all(array, res);
+	 res.result.clear();
+      });
+      print("array (array<int>)", 100000, t);
+   }
+
+   {
+      virtual_array<int> res;
+      virtual_base& base = res;
+      auto const t = measure(runs, [&]() {
+	 parse_all(array, base);
+	 res.result.clear();
+      });
+      print("array (virtual)", 100000, t);
+   }
+
+   {
+      resp::response_ignore res;
+      auto const t = measure(runs, [&]() { parse_all(deep, res); });
+      print("deep (ignore)", 17 * 10000, t);
+   }
+}
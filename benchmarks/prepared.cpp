@@ -0,0 +1,69 @@
+/* Copyright (c) 2019 - 2021 Marcelo Zimbres Silva (mzimbres at gmail dot com)
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#include <iostream>
+#include <iomanip>
+
+#include "memory_stream.hpp"
+
+// Compares commands serialized through the request member functions
+// with prepared commands that only patch their slots. The request is
+// reused so that its capacity is kept across runs.
+
+using namespace aedis;
+
+void print(std::string const& name, int cmds, double us)
+{
+   std::cout
+      << std::left << std::setw(24) << name
+      << std::left << std::setw(16) << 1000 * us / cmds
+      << std::endl;
+}
+
+int main()
+{
+   std::cout
+      << std::left << std::setw(24) << "command"
+      << std::left << std::setw(16) << "ns/command"
+      << std::endl;
+
+   auto const n = 100000;
+   auto const runs = 20;
+
+   std::vector<std::string> keys;
+   for (auto i = 0; i < n; ++i)
+      keys.push_back("user:" + std::to_string(i));
+
+   resp::request req;
+
+   auto run = [&](std::string const& name, auto f) {
+      auto const t = measure(runs, [&]() {
+	 req.clear();
+	 for (auto i = 0; i < n; ++i)
+	    f(i);
+      });
+      print(name, n, t);
+   };
+
+   run("hincrby (request)", [&](int i) { req.hincrby(keys[i], "visits", 1); });
+
+   resp::prepared const incr {resp::command::hincrby, "HINCRBY", resp::slot, "visits", 1};
+   run("hincrby (prepared)", [&](int i) { incr.append(req, keys[i]); });
+
+   run("zadd (request)", [&](int i) { req.zadd("scores", i, keys[i]); });
+
+   resp::prepared const zadd {resp::command::zadd, "ZADD", "scores", resp::slot, resp::slot};
+   run("zadd (prepared)", [&](int i) { zadd.append(req, i, keys[i]); });
+
+   run("get (request)", [&](int i) { req.get(keys[i]); });
+
+   resp::prepared const get {resp::command::get, "GET", resp::slot};
+   run("get (prepared)", [&](int i) { get.append(req, keys[i]); });
+
+   run("ping (assemble)", [&](int) { resp::assemble(req.payload, "PING"); req.events.push({resp::command::ping, resp::event::ignore}); });
+   run("ping (constexpr)", [&](int) { req.ping(); });
+}
@@ -0,0 +1,54 @@
+/* Copyright (c) 2019 - 2021 Marcelo Zimbres Silva (mzimbres at gmail dot com)
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#include <iostream>
+#include <iomanip>
+
+#include "memory_stream.hpp"
+
+// Measures the time taken to parse n pipelined replies, one read call
+// per reply, with a std::string and with resp::read_buffer as storage.
+// With cursors the time per reply must not grow with n.
+
+using namespace aedis;
+
+template <class Storage>
+double parse_pipeline(std::string const& payload, int n)
+{
+   return measure(10, [&]() {
+      memory_stream stream {&payload};
+      Storage buffer;
+      for (auto i = 0; i < n; ++i) {
+	 resp::response_number<int> res;
+	 resp::read(stream, buffer, res);
+      }
+   });
+}
+
+int main()
+{
+   std::cout
+      << std::left << std::setw(10) << "replies"
+      << std::left << std::setw(20) << "string (ns/reply)"
+      << std::left << std::setw(20) << "read_buffer (ns/reply)"
+      << std::endl;
+
+   for (auto n = 1000; n <= 256000; n *= 2) {
+      std::string payload;
+      for (auto i = 0; i < n; ++i)
+	 payload += ":" + std::to_string(i) + "\r\n";
+
+      auto const a = parse_pipeline<std::string>(payload, n);
+      auto const b = parse_pipeline<resp::read_buffer>(payload, n);
+
+      std::cout
+	 << std::left << std::setw(10) << n
+	 << std::left << std::setw(20) << 1000 * a / n
+	 << std::left << std::setw(20) << 1000 * b / n
+	 << std::endl;
+   }
+}
@@ -0,0 +1,112 @@
+/* Copyright (c) 2019 - 2021 Marcelo Zimbres Silva (mzimbres at gmail dot com)
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#include <iostream>
+#include <iomanip>
+
+#include "memory_stream.hpp"
+
+// Measures the serialization of requests, the 20k HSET request of
+// examples/async_all_hashes.cpp and commands with numeric arguments.
+
+using namespace aedis;
+
+struct foo {
+   std::string id {"aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa"};
+   std::string from {"aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa"};
+   std::string nick {"aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa"};
+   std::string avatar {"aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa"};
+   std::string description {"aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa"};
+   std::string location {"aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa"};
+   std::string product {"aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa"};
+   std::string details {"aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa"};
+   std::string values {"aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa"};
+};
+
+template <>
+struct resp::struct_fields<foo> {
+   static constexpr auto value = std::make_tuple(
+      resp::field {"id", &foo::id},
+      resp::field {"from", &foo::from},
+      resp::field {"nick", &foo::nick},
+      resp::field {"avatar", &foo::avatar},
+      resp::field {"description", &foo::description},
+      resp::field {"location", &foo::location},
+      resp::field {"product", &foo::product},
+      resp::field {"details", &foo::details},
+      resp::field {"values", &foo::values});
+};
+
+void print(std::string const& name, int cmds, double us)
+{
+   std::cout
+      << std::left << std::setw(24) << name
+      << std::left << std::setw(16) << 1000 * us / cmds
+      << std::endl;
+}
+
+int main()
+{
+   std::cout
+      << std::left << std::setw(24) << "request"
+      << std::left << std::setw(16) << "ns/command"
+      << std::endl;
+
+   auto const n = 20000;
+   auto const runs = 20;
+
+   std::vector<std::string> names;
+   for (auto i = 0; i < n; ++i)
+      names.push_back("posts:" + std::to_string(i));
+
+   {
+      foo const post;
+      auto const t = measure(runs, [&]() {
+	 resp::request req;
+	 for (auto const& name : names)
+	    req.hset(name, post);
+      });
+      print("hset (struct)", n, t);
+   }
+
+   {
+      foo const obj;
+      std::vector<std::pair<std::string, std::string>> post;
+      resp::for_each_field(obj, [&](auto name, auto const& value) {
+	 post.emplace_back(name, value);
+      });
+
+      auto const t = measure(runs, [&]() {
+	 resp::request req;
+	 for (auto const& name : names)
+	    req.hset(name, post);
+      });
+      print("hset (pairs)", n, t);
+   }
+
+   {
+      auto const t = measure(runs, [&]() {
+	 resp::request req;
+	 for (auto i = 0; i < n; ++i)
+	    req.lrange(names[i], i, -i);
+      });
+      print("lrange", n, t);
+   }
+
+   {
+      std::vector<double> scores;
+      for (auto i = 0; i < 16; ++i)
+	 scores.push_back(i / 7.0);
+
+      auto const t = measure(runs, [&]() {
+	 resp::request req;
+	 for (auto const& name : names)
+	    req.rpush(name, scores);
+      });
+      print("rpush (16 doubles)", n, t);
+   }
+}
@@ -0,0 +1,65 @@
+/* Copyright (c) 2019 - 2021 Marcelo Zimbres Silva (mzimbres at gmail dot com)
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#include <iostream>
+#include <iomanip>
+
+#include "memory_stream.hpp"
+
+// Decodes the reply to a transaction with many commands into
+// response_general, alone and then passing each command result on as
+// a vector, as async_read_responses does.
+
+using namespace aedis;
+
+int main()
+{
+   std::cout
+      << std::left << std::setw(10) << "commands"
+      << std::left << std::setw(20) << "decode (us/reply)"
+      << std::left << std::setw(20) << "visit (us/reply)"
+      << std::endl;
+
+   std::size_t sink = 0;
+   for (auto n = 10; n <= 10000; n *= 10) {
+      // Each command returns an array of ten bulks, like LRANGE.
+      std::string payload = "*" + std::to_string(n) + "\r\n";
+      for (auto i = 0; i < n; ++i) {
+	 payload += "*10\r\n";
+	 for (auto j = 0; j < 10; ++j)
+	    payload += "$7\r\nelement\r\n";
+      }
+
+      resp::response_general res;
+      auto const a = measure(100000 / n, [&]() {
+	 memory_stream stream {&payload};
+	 resp::read_buffer buffer;
+	 resp::read(stream, buffer, res);
+	 sink += res.size();
+	 res.clear();
+      });
+
+      auto const b = measure(100000 / n, [&]() {
+	 memory_stream stream {&payload};
+	 resp::read_buffer buffer;
+	 resp::read(stream, buffer, res);
+	 for (std::size_t i = 0; i < res.size(); ++i) {
+	    std::vector<std::string> v = res.at(i).value;
+	    sink += std::size(v);
+	 }
+	 res.clear();
+      });
+
+      std::cout
+	 << std::left << std::setw(10) << n
+	 << std::left << std::setw(20) << a
+	 << std::left << std::setw(20) << b
+	 << std::endl;
+   }
+
+   return sink == 0;
+}
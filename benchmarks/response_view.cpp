@@ -0,0 +1,53 @@
+/* Copyright (c) 2019 - 2021 Marcelo Zimbres Silva (mzimbres at gmail dot com)
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#include <iostream>
+#include <iomanip>
+
+#include "memory_stream.hpp"
+
+// Reads a large array of short bulk strings, like the reply to HVALS
+// or LRANGE, into copies and into views of the read buffer.
+
+using namespace aedis;
+
+template <class Response>
+double read_array(std::string const& payload)
+{
+   return measure(100, [&]() {
+      memory_stream stream {&payload};
+      resp::read_buffer buffer;
+      Response res;
+      resp::read(stream, buffer, res);
+   });
+}
+
+int main()
+{
+   std::cout
+      << std::left << std::setw(10) << "elements"
+      << std::left << std::setw(20) << "copy (us/reply)"
+      << std::left << std::setw(20) << "view (us/reply)"
+      << std::endl;
+
+   for (auto n = 1000; n <= 64000; n *= 4) {
+      std::string payload = "*" + std::to_string(n) + "\r\n";
+      for (auto i = 0; i < n; ++i) {
+	 auto const v = "value-" + std::to_string(i);
+	 payload += "$" + std::to_string(std::size(v)) + "\r\n" + v + "\r\n";
+      }
+
+      auto const a = read_array<resp::response_array<std::string>>(payload);
+      auto const b = read_array<resp::response_view_array>(payload);
+
+      std::cout
+	 << std::left << std::setw(10) << n
+	 << std::left << std::setw(20) << a
+	 << std::left << std::setw(20) << b
+	 << std::endl;
+   }
+}
@@ -0,0 +1,103 @@
+/* Copyright (c) 2019 - 2021 Marcelo Zimbres Silva (mzimbres at gmail dot com)
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#include <thread>
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+
+#include "memory_stream.hpp"
+
+// Reads the replies to transactions of batch_size GETs with
+// async_read_responses, the server answers each one as soon as it
+// has been written.
+
+using namespace aedis;
+using local = net::local::stream_protocol;
+using socket_type = net::use_awaitable_t<>::as_default_on_t<local::socket>;
+
+auto const transactions = 2000;
+auto const batch_size = 50;
+auto const total = transactions * batch_size;
+
+resp::request<resp::event> make_transaction()
+{
+   resp::request req;
+   req.multi();
+   for (auto i = 0; i < batch_size; ++i)
+      req.get("key");
+   req.exec();
+   return req;
+}
+
+void serve(local::socket& s, std::size_t req_size)
+{
+   std::string replies = "+OK\r\n";
+   for (auto i = 0; i < batch_size; ++i)
+      replies += "+QUEUED\r\n";
+   replies += "*" + std::to_string(batch_size) + "\r\n";
+   for (auto i = 0; i < batch_size; ++i)
+      replies += "$5\r\nvalue\r\n";
+
+   std::vector<char> buf(1 << 20);
+   std::size_t bytes = 0;
+   boost::system::error_code ec;
+   for (auto answered = 0; answered < transactions && !ec;) {
+      bytes += s.read_some(net::buffer(buf), ec);
+      for (; !ec && bytes >= req_size; bytes -= req_size, ++answered)
+	 net::write(s, net::buffer(replies), ec);
+   }
+}
+
+struct receiver : resp::receiver_base<resp::event> {
+   using event_type = resp::event;
+   socket_type* socket = nullptr;
+   int received = 0;
+
+   void receive(resp::response_id<event_type> const&, std::vector<std::string>) override
+   {
+      if (++received == total)
+	 socket->close();
+   }
+};
+
+int main()
+{
+   net::io_context ioc;
+   socket_type client {ioc};
+   local::socket server {ioc};
+   net::local::connect_pair(client, server);
+
+   std::thread t {[&]() { serve(server, std::size(make_transaction().payload)); }};
+
+   receiver recv;
+   recv.socket = &client;
+   for (auto i = 0; i < transactions; ++i)
+      recv.add(make_transaction());
+
+   co_spawn(ioc, [&]() -> net::awaitable<void> {
+      try {
+	 co_await resp::async_write(client, recv.reqs.front(), net::use_awaitable);
+	 co_await resp::async_read_responses(client, recv);
+      } catch (...) {
+      }
+   }, net::detached);
+
+   auto const begin = std::chrono::steady_clock::now();
+   ioc.run();
+   std::chrono::duration<double, std::milli> const d =
+      std::chrono::steady_clock::now() - begin;
+   t.join();
+
+   std::cout
+      << std::left << std::setw(16) << "ms"
+      << std::left << std::setw(16) << "commands/ms"
+      << std::endl
+      << std::left << std::setw(16) << d.count()
+      << std::left << std::setw(16) << total / d.count()
+      << std::endl;
+}
@@ -0,0 +1,127 @@
+/* Copyright (c) 2019 - 2021 Marcelo Zimbres Silva (mzimbres at gmail dot com)
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#include <queue>
+#include <thread>
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+
+#include "memory_stream.hpp"
+
+// Many coroutines issue commands on one socket. They are either
+// written one request at a time, as with receiver_base::add, or
+// coalesced by the writer.
+
+using namespace aedis;
+using local = net::local::stream_protocol;
+
+auto const producers = 500;
+auto const commands = 200;
+
+void print(std::string const& name, double ms, std::size_t writes)
+{
+   std::cout
+      << std::left << std::setw(24) << name
+      << std::left << std::setw(16) << ms
+      << std::left << std::setw(16) << writes
+      << std::endl;
+}
+
+// Runs the producers and returns the elapsed time in milliseconds.
+template <class Enqueue>
+double run_producers(net::io_context& ioc, Enqueue enqueue)
+{
+   for (auto i = 0; i < producers; ++i) {
+      co_spawn(ioc, [&, i]() -> net::awaitable<void> {
+	 auto const key = "key:" + std::to_string(i);
+	 for (auto j = 0; j < commands; ++j) {
+	    enqueue(key);
+	    co_await net::post(ioc, net::use_awaitable);
+	 }
+      }, net::detached);
+   }
+
+   auto const begin = std::chrono::steady_clock::now();
+   ioc.run();
+   std::chrono::duration<double, std::milli> const d =
+      std::chrono::steady_clock::now() - begin;
+   return d.count();
+}
+
+int main()
+{
+   std::cout
+      << std::left << std::setw(24) << "writer"
+      << std::left << std::setw(16) << "ms"
+      << std::left << std::setw(16) << "writes"
+      << std::endl;
+
+   {
+      net::io_context ioc;
+      local::socket writer {ioc};
+      local::socket reader {ioc};
+      net::local::connect_pair(writer, reader);
+      std::thread drain {[&]() {
+	 std::vector<char> buf(1 << 20);
+	 boost::system::error_code ec;
+	 while (!ec)
+	    reader.read_some(net::buffer(buf), ec);
+      }};
+
+      // One write per request, the next one starts when the previous
+      // completes.
+      std::queue<resp::request<>> reqs;
+      std::size_t writes = 0;
+      auto write_all = [&]() -> net::awaitable<void> {
+	 while (!std::empty(reqs)) {
+	    co_await resp::async_write(writer, reqs.front(), net::use_awaitable);
+	    reqs.pop();
+	    ++writes;
+	 }
+      };
+
+      auto const t = run_producers(ioc, [&](auto const& key) {
+	 resp::request req;
+	 req.get(key);
+	 reqs.push(std::move(req));
+	 if (std::size(reqs) == 1)
+	    co_spawn(ioc, write_all(), net::detached);
+      });
+
+      print("request per write", t, writes);
+      writer.shutdown(local::socket::shutdown_send);
+      drain.join();
+   }
+
+   for (auto window : {0, 50}) {
+      net::io_context ioc;
+      local::socket writer {ioc};
+      local::socket reader {ioc};
+      net::local::connect_pair(writer, reader);
+      std::thread drain {[&]() {
+	 std::vector<char> buf(1 << 20);
+	 boost::system::error_code ec;
+	 while (!ec)
+	    reader.read_some(net::buffer(buf), ec);
+      }};
+
+      resp::coalescing_writer<local::socket> w {writer, {std::chrono::microseconds {window}}};
+      co_spawn(ioc, w.run([](auto&) { }), net::detached);
+
+      std::size_t sent = 0;
+      auto const t = run_producers(ioc, [&](auto const& key) {
+	 w.enqueue([&](auto& req) { req.get(key); });
+	 if (++sent == producers * commands)
+	    w.close();
+      });
+
+      print("coalesced (" + std::to_string(window) + " us)", t, w.writes());
+      writer.shutdown(local::socket::shutdown_send);
+      drain.join();
+   }
+}
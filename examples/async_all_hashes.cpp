@@ -29,20 +29,19 @@ struct foo {
    std::string values {"aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa"};
 };
 
-auto make_hset_arg(foo const& p)
-{
-   std::vector<std::pair<std::string, std::string>> v;
-   v.push_back({"id", p.id});
-   v.push_back({"from", p.from});
-   v.push_back({"nick", p.nick});
-   v.push_back({"avatar", p.avatar});
-   v.push_back({"description", p.description});
-   v.push_back({"location", p.location});
-   v.push_back({"product", p.product});
-   v.push_back({"details", p.details});
-   v.push_back({"values", p.values});
-   return v;
-}
+template <>
+struct resp::struct_fields<foo> {
+   static constexpr auto value = std::make_tuple(
+      resp::field {"id", &foo::id},
+      resp::field {"from", &foo::from},
+      resp::field {"nick", &foo::nick},
+      resp::field {"avatar", &foo::avatar},
+      resp::field {"description", &foo::description},
+      resp::field {"location", &foo::location},
+      resp::field {"product", &foo::product},
+      resp::field {"details", &foo::details},
+      resp::field {"values", &foo::values});
+};
 
 // tcp::resolver::results_type const& r
 net::awaitable<void> create_hashes()
@@ -52,7 +51,7 @@ net::awaitable<void> create_hashes()
    req.flushall();
    for (auto i = 0; i < std::ssize(posts); ++i) {
       std::string const name = "posts:" + std::to_string(i);
-      req.hset(name, make_hset_arg(posts[i]));
+      req.hset(name, posts[i]);
    }
    req.quit();
 
@@ -90,16 +89,16 @@ net::awaitable<void> read_hashes_coro()
    // Generates the request to retrieve all hashes.
    resp::request pv;
    for (auto const& o : keys.result)
-      pv.hvals(o);
+      pv.hgetall(o);
    pv.quit();
 
    co_await async_write(socket, net::buffer(pv.payload));
 
-   for (auto const& key : keys.result) {
-      resp::response_array<std::string> value;
+   // Fields are decoded in place, reusing the storage of the strings.
+   // Without HELLO 3 the reply to HGETALL is a flat array of pairs.
+   resp::response_struct<foo> value {resp::hash_layout::pairs};
+   for ([[maybe_unused]] auto const& key : keys.result)
       co_await resp::async_read(socket, buffer, value);
-      //print(value.result);
-   }
 
    resp::response_ignore quit;
    co_await resp::async_read(socket, buffer, quit);
@@ -124,15 +123,14 @@ void read_hashes(net::io_context& ioc)
    // Generates the request to retrieve all hashes.
    resp::request pv;
    for (auto const& o : keys.result)
-      pv.hvals(o);
+      pv.hgetall(o);
    pv.quit();
 
    write(socket, pv);
 
-   for (auto const& key : keys.result) {
-      resp::response_array<std::string> value;
+   resp::response_struct<foo> value {resp::hash_layout::pairs};
+   for ([[maybe_unused]] auto const& key : keys.result)
       resp::read(socket, buffer, value);
-   }
 
    resp::response_ignore quit;
    resp::read(socket, buffer, quit);
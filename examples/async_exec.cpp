@@ -0,0 +1,90 @@
+/* Copyright (c) 2019 - 2021 Marcelo Zimbres Silva (mzimbres at gmail dot com)
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#include <iostream>
+
+#include <aedis/aedis.hpp>
+
+namespace net = aedis::net;
+using tcp = net::ip::tcp;
+using tcp_socket = net::use_awaitable_t<>::as_default_on_t<tcp::socket>;
+
+namespace this_coro = net::this_coro;
+
+using namespace net;
+using namespace aedis;
+
+// Many workers share one connection, each one waits for its own
+// replies.
+net::awaitable<void> worker(resp::connection<tcp_socket>& conn, int id)
+{
+   auto const key = "worker:" + std::to_string(id);
+
+   resp::request req;
+   req.incr(key);
+   req.get(key);
+
+   resp::response_number<long long> incr;
+   resp::response_blob_string get;
+   co_await conn.exec(req, incr, get);
+
+   std::cout << key << ": " << incr.result << " " << get.result << std::endl;
+}
+
+net::awaitable<void> workers(resp::connection<tcp_socket>& conn)
+{
+   auto ex = co_await this_coro::executor;
+
+   resp::request hello;
+   hello.hello("3");
+   resp::response_ignore ignore;
+   co_await conn.exec(hello, ignore);
+
+   // Cancelled once all workers are done.
+   net::steady_timer all_done {ex, net::steady_timer::time_point::max()};
+
+   auto const n = 100;
+   auto done = 0;
+   for (auto i = 0; i < n; ++i) {
+      co_spawn(ex, worker(conn, i), [&](std::exception_ptr) {
+	 if (++done == n) {
+	    conn.enqueue([](auto& req) { req.quit(); });
+	    all_done.cancel();
+	 }
+      });
+   }
+
+   while (done != n) {
+      boost::system::error_code ec;
+      co_await all_done.async_wait(net::redirect_error(net::use_awaitable, ec));
+   }
+}
+
+net::awaitable<void> example()
+{
+   try {
+      auto ex = co_await this_coro::executor;
+
+      tcp::resolver resv(ex);
+      tcp_socket socket {ex};
+      co_await net::async_connect(socket, resv.resolve("127.0.0.1", "6379"));
+
+      // Runs until the server closes the connection after QUIT.
+      resp::connection<tcp_socket> conn {socket};
+      co_spawn(ex, workers(conn), net::detached);
+      co_await conn.run();
+   } catch (std::exception const& e) {
+      std::cerr << e.what() << std::endl;
+   }
+}
+
+int main()
+{
+   io_context ioc {1};
+   co_spawn(ioc, example(), detached);
+   ioc.run();
+}
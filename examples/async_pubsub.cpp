@@ -52,9 +52,11 @@ struct myreceiver : public resp::receiver_base<myevent>
    }
 };
 
-auto make_req()
+// Requests are taken from the pool of the receiver so that their
+// capacity is reused once their responses have been read.
+auto make_req(resp::request_pool<myevent>& pool)
 {
-   resp::request<myevent> req;
+   auto req = pool.get();
    req.hello();
    req.flushall();
    req.subscribe("channel");
@@ -97,7 +99,7 @@ filler(
    auto ex = co_await this_coro::executor;
    try {
       for (;;) {
-	 if (recv.add(make_req())) {
+	 if (recv.add(make_req(recv.pool))) {
 	    co_await async_write(
 	       socket,
 	       recv.reqs.front());
@@ -15,8 +15,17 @@ namespace ip = net::ip;
 using tcp = ip::tcp;
 }
 
+#include <aedis/connection.hpp>
+#include <aedis/dispatcher.hpp>
+#include <aedis/error.hpp>
+#include <aedis/glob.hpp>
+#include <aedis/prepared.hpp>
+#include <aedis/push_channel.hpp>
 #include <aedis/read.hpp>
+#include <aedis/read_buffer.hpp>
 #include <aedis/request.hpp>
 #include <aedis/response.hpp>
+#include <aedis/response_view.hpp>
 #include <aedis/version.hpp>
 #include <aedis/write.hpp>
+#include <aedis/writer.hpp>
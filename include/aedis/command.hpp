@@ -7,6 +7,8 @@
 
 #pragma once
 
+#include "type.hpp"
+
 namespace aedis { namespace resp {
 
 enum class command
@@ -114,6 +116,71 @@ auto const* to_string(command c)
    }
 }
 
+// The types of a successful reply to the command in RESP3, errors
+// are not included. Commands whose reply depends on the arguments
+// return all the types they may produce.
+inline
+type_set reply_types(command c)
+{
+   switch (c) {
+      case command::append:
+      case command::bitcount:
+      case command::del:
+      case command::expire:
+      case command::hincrby:
+      case command::hlen:
+      case command::hset:
+      case command::incr:
+      case command::llen:
+      case command::lpush:
+      case command::publish:
+      case command::rpush:
+      case command::sadd:
+      case command::scard:
+      case command::zadd:
+      case command::zremrangebyscore:
+	 return make_type_set(type::number);
+      case command::auth:
+      case command::bgrewriteaof:
+      case command::bgsave:
+      case command::flushall:
+      case command::ltrim:
+      case command::multi:
+      case command::ping:
+      case command::quit:
+	 return make_type_set(type::simple_string);
+      case command::set:
+	 return make_type_set(type::simple_string, type::blob_string, type::null);
+      case command::get:
+      case command::hget:
+	 return make_type_set(type::blob_string, type::null);
+      case command::lpop:
+	 return make_type_set(type::blob_string, type::array, type::null);
+      case command::exec:
+	 return make_type_set(type::array, type::null);
+      case command::hkeys:
+      case command::hmget:
+      case command::hvals:
+      case command::keys:
+      case command::lrange:
+      case command::role:
+      case command::zrange:
+      case command::zrangebyscore:
+	 return make_type_set(type::array);
+      case command::smembers:
+	 return make_type_set(type::set);
+      case command::hello:
+      case command::hgetall:
+	 return make_type_set(type::map);
+      case command::psubscribe:
+      case command::subscribe:
+      case command::unsubscribe:
+	 return make_type_set(type::push);
+      default:
+	 return all_types;
+   }
+}
+
 }
 }
 
@@ -0,0 +1,460 @@
+/* Copyright (c) 2019 - 2021 Marcelo Zimbres Silva (mzimbres at gmail dot com)
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#pragma once
+
+#include <array>
+#include <tuple>
+#include <string>
+#include <utility>
+#include <exception>
+#include <string_view>
+#include <vector>
+
+#include <boost/asio.hpp>
+
+#include "read.hpp"
+#include "error.hpp"
+#include "writer.hpp"
+#include "push_channel.hpp"
+#include "response.hpp"
+#include "ring_queue.hpp"
+#include "read_buffer.hpp"
+
+namespace aedis { namespace resp {
+
+/* A full-duplex connection, requests are written while the replies to
+ * earlier ones are still being read. Any number of coroutines may
+ * issue requests and wait for their own replies, for example
+ *
+ *    resp::connection<tcp_socket> conn {socket};
+ *    co_spawn(ex, conn.run(), net::detached);
+ *    ...
+ *    resp::request req;
+ *    req.get("key");
+ *    req.incr("counter");
+ *    resp::response_blob_string value;
+ *    resp::response_number<long long> counter;
+ *    co_await conn.exec(req, value, counter);
+ *
+ * Replies are matched to the commands in the order they were written.
+ * Those of commands sent with exec are parsed into its responses,
+ * those of commands sent with enqueue are passed to recv.receive like
+ * in async_read_responses. Pushes are passed to recv with
+ * command::none or to a push_channel given to run. No write starts
+ * while max_in_flight commands wait for a reply, which bounds the
+ * memory used by the server. The limit is checked before each write
+ * and a write is not split, so the commands coalesced in it, that is
+ * those enqueued since the previous write, may take the count past
+ * the limit.
+ */
+template <class AsyncStream, class Event = event>
+class connection {
+public:
+   struct config {
+      std::size_t max_in_flight = 1024;
+      typename coalescing_writer<AsyncStream, Event>::config writer;
+   };
+
+private:
+   // Consumes the part of a reply the response of its command does not
+   // support. The type of its first element and the message of the
+   // first error are kept.
+   struct rejected_reply : response_ignore {
+      type t = type::invalid;
+      std::string message;
+
+      void add(type u, std::string_view s = {})
+      {
+	 if (t == type::invalid)
+	    t = u;
+	 if (std::empty(message))
+	    message = s;
+      }
+
+      void clear()
+      {
+	 t = type::invalid;
+	 message.clear();
+      }
+
+      void select_array(int) { add(type::array); }
+      void select_push(int) { add(type::push); }
+      void select_set(int) { add(type::set); }
+      void select_map(int) { add(type::map); }
+      void select_attribute(int) { add(type::attribute); }
+
+      void on_simple_string(std::string_view) { add(type::simple_string); }
+      void on_simple_error(std::string_view s) { add(type::simple_error, s); }
+      void on_number(std::string_view) { add(type::number); }
+      void on_double(std::string_view) { add(type::double_type); }
+      void on_bool(std::string_view) { add(type::boolean); }
+      void on_big_number(std::string_view) { add(type::big_number); }
+      void on_null() { add(type::null); }
+      void on_blob_error(std::string_view s = {}) { add(type::blob_error, s); }
+      void on_verbatim_string(std::string_view = {}) { add(type::verbatim_string); }
+      void on_blob_string(std::string_view = {}) { add(type::blob_string); }
+      void on_streamed_string_part(std::string_view = {}) { add(type::streamed_string_part); }
+   };
+
+   // The state of an exec call, it lives in the frame of the calling
+   // coroutine.
+   class exec_base {
+   public:
+      // The number of replies and the index of the next one.
+      std::size_t size;
+      std::size_t next = 0;
+
+      // The connection failed.
+      std::exception_ptr error;
+
+      // A reply the response does not support, for example an error,
+      // was consumed. The first one is reported to the caller.
+      boost::system::error_code ec;
+      std::string message;
+
+      bool done = false;
+      net::steady_timer timer;
+
+      exec_base(net::any_io_executor ex, std::size_t n)
+      : size {n}
+      , timer {ex}
+      { }
+
+      // Reads the next reply into its response. Elements the response
+      // does not support and the rest of the reply are read into the
+      // rejected_reply, ec is then error::unexpected_type.
+      virtual net::awaitable<void>
+      read(AsyncStream& stream, read_buffer& buffer, boost::system::error_code& ec) = 0;
+
+      void reject(type t, std::string_view msg)
+      {
+	 if (ec)
+	    return;
+
+	 switch (t) {
+	    case type::simple_error: ec = error::simple_error; break;
+	    case type::blob_error: ec = error::blob_error; break;
+	    default: ec = error::unexpected_type;
+	 }
+	 message = msg;
+      }
+
+      void complete(std::exception_ptr e = nullptr)
+      {
+	 error = e;
+	 done = true;
+	 timer.cancel();
+      }
+   };
+
+   template <class... Responses>
+   class exec_op : public exec_base {
+   private:
+      std::tuple<with_fallback<Responses, rejected_reply>...> res_;
+
+      // Returns the awaitable of the read directly, a coroutine here
+      // would add a frame per reply.
+      template <std::size_t I>
+      static net::awaitable<void>
+      read_one(
+	 exec_op& op,
+	 AsyncStream& stream,
+	 read_buffer& buffer,
+	 boost::system::error_code& ec)
+      {
+	 return resp::async_read(
+	    stream, buffer, std::get<I>(op.res_), net::redirect_error(net::use_awaitable, ec));
+      }
+
+      template <std::size_t... Is>
+      static constexpr auto make_readers(std::index_sequence<Is...>)
+      {
+	 using reader = net::awaitable<void> (*)(
+	    exec_op&, AsyncStream&, read_buffer&, boost::system::error_code&);
+	 return std::array<reader, sizeof...(Is)> {&read_one<Is>...};
+      }
+
+   public:
+      exec_op(net::any_io_executor ex, rejected_reply* rejected, Responses&... res)
+      : exec_base {ex, sizeof...(Responses)}
+      , res_ {with_fallback<Responses, rejected_reply> {&res, rejected}...}
+      { }
+
+      net::awaitable<void>
+      read(AsyncStream& stream, read_buffer& buffer, boost::system::error_code& ec) override
+      {
+	 static constexpr auto readers =
+	    make_readers(std::make_index_sequence<sizeof...(Responses)> {});
+	 return readers[this->next](*this, stream, buffer, ec);
+      }
+   };
+
+   /* Flattens the leaves of the replies to enqueued commands and of
+    * pushes. Unlike response_array it accepts every type, so that
+    * nulls and errors do not stop the reader. Nulls are passed as
+    * empty strings and errors as their message, the type passed to
+    * the receiver tells them apart.
+    */
+   struct any_reply : response_ignore {
+      std::vector<std::string> result;
+
+      void add(std::string_view s) { result.emplace_back(s); }
+
+      void select_array(int n) { reserve_more(result, n); }
+      void select_push(int n) { reserve_more(result, n); }
+      void select_set(int n) { reserve_more(result, n); }
+      void select_map(int n) { reserve_more(result, n); }
+
+      void on_simple_string(std::string_view s) { add(s); }
+      void on_simple_error(std::string_view s) { add(s); }
+      void on_number(std::string_view s) { add(s); }
+      void on_double(std::string_view s) { add(s); }
+      void on_bool(std::string_view s) { add(s); }
+      void on_big_number(std::string_view s) { add(s); }
+      void on_null() { add({}); }
+      void on_blob_error(std::string_view s = {}) { add(s); }
+      void on_verbatim_string(std::string_view s = {}) { add(s); }
+      void on_blob_string(std::string_view s = {}) { add(s); }
+      void on_streamed_string_part(std::string_view s = {}) { add(s); }
+   };
+
+   struct in_flight_cmd {
+      command cmd;
+      Event event;
+      exec_base* owner;
+   };
+
+   struct ignore_receiver {
+      void receive(response_id<Event> const&, std::vector<std::string>) { }
+   };
+
+   AsyncStream& stream_;
+   config cfg_;
+   coalescing_writer<AsyncStream, Event> writer_;
+
+   // The exec call each pending command belongs to or null, in the
+   // order of the events of the pending request.
+   ring_queue<exec_base*> pending_owners_;
+   ring_queue<in_flight_cmd> in_flight_;
+   rejected_reply rejected_;
+
+   std::exception_ptr failed_;
+
+   bool ready() const noexcept
+      { return std::size(in_flight_) < cfg_.max_in_flight; }
+
+   void on_write(request<Event>& req)
+   {
+      for (; !std::empty(req.events); req.events.pop()) {
+	 auto const [cmd, e] = req.events.front();
+	 in_flight_.push({cmd, e, pending_owners_.front()});
+	 pending_owners_.pop();
+      }
+   }
+
+   // Resumes the exec calls that wait for replies that will not come.
+   void fail(std::exception_ptr e)
+   {
+      failed_ = e;
+      for (; !std::empty(in_flight_); in_flight_.pop()) {
+	 if (auto* op = in_flight_.front().owner; op && !op->done)
+	    op->complete(e);
+      }
+      for (; !std::empty(pending_owners_); pending_owners_.pop()) {
+	 if (auto* op = pending_owners_.front(); op && !op->done)
+	    op->complete(e);
+      }
+   }
+
+public:
+   connection(AsyncStream& stream, config cfg = {})
+   : stream_ {stream}
+   , cfg_ {cfg}
+   , writer_ {stream, cfg.writer}
+   { }
+
+   // Calls f with the request the next write is assembled in.
+   template <class F>
+   void enqueue(F f)
+   {
+      writer_.enqueue([&](auto& req) {
+	 auto const n = std::size(req.events);
+	 f(req);
+	 for (auto i = n; i < std::size(req.events); ++i)
+	    pending_owners_.push(nullptr);
+      });
+   }
+
+   /* Sends the request and waits for its replies, that are parsed into
+    * res, one response per command. Errors are thrown, a response that
+    * does not support the types the command replies with raises
+    * error::unexpected_type before anything is sent, a number of
+    * responses that differs from the number of commands raises
+    * error::response_count.
+    *
+    * A reply with an element its response does not support, for
+    * example an error or a null, also inside an aggregate, is consumed
+    * and the other replies are still read. Then error::simple_error,
+    * error::blob_error or error::unexpected_type is thrown, depending
+    * on the first such element, with the error message if there is
+    * one. Other callers are not affected.
+    */
+   template <class... Responses>
+   net::awaitable<void> exec(request<Event> const& req, Responses&... res)
+   {
+      if (std::size(req.events) != sizeof...(Responses))
+	 throw boost::system::system_error {make_error_code(error::response_count)};
+
+      // There is nothing to send nor to wait for.
+      if constexpr (sizeof...(Responses) == 0)
+	 co_return;
+
+      std::size_t i = 0;
+      auto const supported =
+	 ((reply_types(req.events[i++].first) & response_types<Responses>()) && ...);
+      if (!supported)
+	 throw boost::system::system_error {make_error_code(error::unexpected_type)};
+
+      if (failed_)
+	 std::rethrow_exception(failed_);
+
+      exec_op<Responses...> op {co_await net::this_coro::executor, &rejected_, res...};
+      writer_.enqueue([&](auto& pending) { pending.append_request(req); });
+      for (std::size_t j = 0; j < sizeof...(Responses); ++j)
+	 pending_owners_.push(&op);
+
+      while (!op.done) {
+	 boost::system::error_code ec;
+	 op.timer.expires_at(net::steady_timer::time_point::max());
+	 co_await op.timer.async_wait(net::redirect_error(net::use_awaitable, ec));
+      }
+
+      if (op.error)
+	 std::rethrow_exception(op.error);
+
+      if (op.ec)
+	 throw boost::system::system_error {op.ec, op.message};
+   }
+
+   // Stops writing once the pending commands have been written.
+   void close()
+      { writer_.close(); }
+
+   auto in_flight() const noexcept { return std::size(in_flight_); }
+   auto const& writer() const noexcept { return writer_; }
+
+   /* Runs the writer and the reader until reading or writing fails,
+    * for example because the stream was closed. A failed write closes
+    * the stream. The error is thrown once the writer has stopped, exec
+    * calls waiting for replies are resumed with it and the push channel
+    * is closed. A reply that arrives with no command waiting for it
+    * fails with error::unsolicited_reply.
+    */
+   template <class Receiver>
+   net::awaitable<void> run(Receiver& recv, push_channel* pushes = nullptr)
+   {
+      auto ex = co_await net::this_coro::executor;
+
+      // Cancelled when the writer stops, it never expires otherwise.
+      net::steady_timer writer_stopped {ex, net::steady_timer::time_point::max()};
+      bool writer_done = false;
+
+      // A failed write does not necessarily fail the reads, the stream
+      // is closed so that the reader stops with it.
+      std::exception_ptr error;
+      std::exception_ptr write_error;
+      co_spawn(
+	 ex,
+	 writer_.run(
+	    [this](auto& req) { on_write(req); },
+	    [this]() { return ready(); }),
+	 [&](std::exception_ptr e) {
+	    writer_done = true;
+	    writer_stopped.cancel();
+	    if (e && !error) {
+	       write_error = e;
+	       boost::system::error_code ignored;
+	       stream_.close(ignored);
+	    }
+	 });
+
+      try {
+	 read_buffer buffer;
+	 any_reply res;
+	 for (;;) {
+	    type t;
+	    co_await resp::async_read_type(stream_, buffer, t, net::use_awaitable);
+
+	    if (t == type::push) {
+	       co_await resp::async_read(stream_, buffer, res, net::use_awaitable);
+	       if (!pushes)
+		  recv.receive({command::none, t, Event::ignore}, std::move(res.result));
+	       else if (!pushes->try_push(res.result))
+		  co_await pushes->async_push(res.result);
+	       res.result.clear();
+	       continue;
+	    }
+
+	    if (std::empty(in_flight_))
+	       throw boost::system::system_error {make_error_code(error::unsolicited_reply)};
+
+	    auto const [cmd, e, op] = in_flight_.front();
+	    if (op) {
+	       // Malformed replies fail the connection.
+	       boost::system::error_code ec;
+	       co_await op->read(stream_, buffer, ec);
+	       if (ec == error::unexpected_type) {
+		  op->reject(rejected_.t, rejected_.message);
+		  rejected_.clear();
+	       } else if (ec) {
+		  throw boost::system::system_error {ec};
+	       }
+
+	       if (++op->next == op->size)
+		  op->complete();
+	    } else {
+	       co_await resp::async_read(stream_, buffer, res, net::use_awaitable);
+	       recv.receive({cmd, t, e}, std::move(res.result));
+	       res.result.clear();
+	    }
+
+	    in_flight_.pop();
+	    if (std::size(in_flight_) + 1 == cfg_.max_in_flight)
+	       writer_.notify();
+	 }
+      } catch (...) {
+	 error = std::current_exception();
+      }
+
+      // The writer coroutine refers to this object.
+      writer_.close();
+      while (!writer_done) {
+	 boost::system::error_code ec;
+	 co_await writer_stopped.async_wait(net::redirect_error(net::use_awaitable, ec));
+      }
+
+      if (write_error)
+	 error = write_error;
+
+      fail(error);
+      if (pushes)
+	 pushes->close();
+
+      std::rethrow_exception(error);
+   }
+
+   // Runs the connection dropping the replies to enqueue.
+   net::awaitable<void> run(push_channel* pushes = nullptr)
+   {
+      ignore_receiver recv;
+      co_await run(recv, pushes);
+   }
+};
+
+} // resp
+} // aedis
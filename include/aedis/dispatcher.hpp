@@ -0,0 +1,211 @@
+/* Copyright (c) 2019 - 2021 Marcelo Zimbres Silva (mzimbres at gmail dot com)
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <functional>
+#include <string_view>
+#include <unordered_map>
+
+#include "glob.hpp"
+#include "request.hpp"
+
+namespace aedis { namespace resp {
+
+/* A pub/sub message as passed to the handlers of a dispatcher. The
+ * views point into memory kept alive by owner, that is shared by all
+ * handlers the message is delivered to. Handlers that keep the message
+ * after returning copy it, which only copies the shared pointer.
+ */
+struct message {
+   std::string_view channel;
+   std::string_view payload;
+
+   // The pattern of a pmessage, empty for a message.
+   std::string_view pattern;
+
+   std::shared_ptr<void const> owner;
+
+   // The payload as a value to publish or set, see request.
+   value_ref payload_ref() const noexcept
+      { return {payload, owner}; }
+};
+
+/* Fans pub/sub messages out to local handlers, for example
+ *
+ *    resp::dispatcher disp;
+ *    disp.subscribe("news", [](auto const& msg) { ... });
+ *    disp.psubscribe("user:*", [](auto const& msg) { ... });
+ *    ...
+ *    for (;;) {
+ *       auto push = co_await pushes.async_receive();
+ *       disp.dispatch(push);
+ *    }
+ *
+ * Handlers of channels are found with a hash lookup, patterns are
+ * compiled globs matched against the channel. Handlers must not
+ * subscribe or unsubscribe while a message is being dispatched.
+ */
+class dispatcher {
+public:
+   using handler = std::function<void(message const&)>;
+   using id_type = std::size_t;
+
+private:
+   struct entry {
+      id_type id;
+      handler h;
+   };
+
+   struct pattern_entry {
+      glob g;
+      std::vector<entry> handlers;
+   };
+
+   // Lets channels be looked up with a string_view.
+   struct string_hash {
+      using is_transparent = void;
+      std::size_t operator()(std::string_view s) const noexcept
+	 { return std::hash<std::string_view> {}(s); }
+   };
+
+   using channel_map =
+      std::unordered_map<std::string, std::vector<entry>, string_hash, std::equal_to<>>;
+
+   channel_map channels_;
+   std::vector<pattern_entry> patterns_;
+
+   // The channel or pattern of each handler, to unsubscribe it.
+   std::unordered_map<id_type, std::pair<std::string, bool>> ids_;
+   id_type next_id_ = 0;
+
+   id_type add(std::vector<entry>& v, std::string_view key, bool is_pattern, handler h)
+   {
+      auto const id = next_id_++;
+      v.push_back({id, std::move(h)});
+      ids_.emplace(id, std::make_pair(std::string {key}, is_pattern));
+      return id;
+   }
+
+   static bool remove(std::vector<entry>& v, id_type id)
+   {
+      auto const it = std::find_if(std::begin(v), std::end(v),
+	 [&](auto const& e) { return e.id == id; });
+      if (it == std::end(v))
+	 return false;
+      v.erase(it);
+      return true;
+   }
+
+public:
+   // Calls h with the messages published to channel.
+   id_type subscribe(std::string_view channel, handler h)
+   {
+      auto it = channels_.find(channel);
+      if (it == std::end(channels_))
+	 it = channels_.emplace(std::string {channel}, std::vector<entry> {}).first;
+      return add(it->second, channel, false, std::move(h));
+   }
+
+   // Calls h with the messages published to channels matching pattern.
+   id_type psubscribe(std::string_view pattern, handler h)
+   {
+      auto it = std::find_if(std::begin(patterns_), std::end(patterns_),
+	 [&](auto const& p) { return p.g.pattern() == pattern; });
+      if (it == std::end(patterns_))
+	 it = patterns_.insert(std::end(patterns_), {glob {pattern}, {}});
+      return add(it->handlers, pattern, true, std::move(h));
+   }
+
+   bool unsubscribe(id_type id)
+   {
+      auto const node = ids_.find(id);
+      if (node == std::end(ids_))
+	 return false;
+
+      auto const& [key, is_pattern] = node->second;
+      if (is_pattern) {
+	 auto it = std::find_if(std::begin(patterns_), std::end(patterns_),
+	    [&](auto const& p) { return p.g.pattern() == key; });
+	 remove(it->handlers, id);
+	 if (std::empty(it->handlers))
+	    patterns_.erase(it);
+      } else {
+	 auto it = channels_.find(key);
+	 remove(it->second, id);
+	 if (std::empty(it->second))
+	    channels_.erase(it);
+      }
+
+      ids_.erase(node);
+      return true;
+   }
+
+   auto handlers() const noexcept { return std::size(ids_); }
+
+   /* Delivers msg to the handlers of its channel and of the patterns
+    * matching it, returns how many were called. The owner is only
+    * created, by calling make_owner, when at least one handler matches.
+    */
+   template <class MakeOwner>
+   std::size_t dispatch(message& msg, MakeOwner make_owner)
+   {
+      std::size_t n = 0;
+      auto deliver = [&](std::vector<entry> const& v) {
+	 if (!std::empty(v) && n == 0)
+	    make_owner(msg);
+	 for (auto const& e : v)
+	    e.h(msg);
+	 n += std::size(v);
+      };
+
+      if (auto const it = channels_.find(msg.channel); it != std::end(channels_))
+	 deliver(it->second);
+
+      for (auto const& p : patterns_) {
+	 if (p.g.match(msg.channel))
+	    deliver(p.handlers);
+      }
+
+      return n;
+   }
+
+   /* Dispatches a push read with response_array or from a
+    * push_channel, either message, channel, payload or pmessage,
+    * pattern, channel, payload. The strings are moved into a single
+    * shared allocation, push is left empty if any handler was called.
+    * Other pushes are ignored.
+    */
+   std::size_t dispatch(std::vector<std::string>& push)
+   {
+      message msg;
+      if (std::size(push) == 3 && push[0] == "message") {
+	 msg.channel = push[1];
+	 msg.payload = push[2];
+      } else if (std::size(push) == 4 && push[0] == "pmessage") {
+	 msg.pattern = push[1];
+	 msg.channel = push[2];
+	 msg.payload = push[3];
+      } else {
+	 return 0;
+      }
+
+      return dispatch(msg, [&](message& m) {
+	 // Moving the vector leaves its elements where they are, the
+	 // views stay valid.
+	 m.owner = std::make_shared<std::vector<std::string> const>(std::move(push));
+      });
+   }
+};
+
+} // resp
+} // aedis
@@ -0,0 +1,75 @@
+/* Copyright (c) 2019 - 2021 Marcelo Zimbres Silva (mzimbres at gmail dot com)
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#pragma once
+
+#include <string>
+#include <type_traits>
+
+#include <boost/system/error_code.hpp>
+
+namespace aedis { namespace resp {
+
+// Errors reported by the parser, the push channel, the connection and
+// prepared commands.
+enum class error
+{ unexpected_type = 1 // The response does not support the type received.
+, invalid_type        // The element does not start with a RESP3 type.
+, invalid_header      // The length in an aggregate or bulk header is malformed.
+, push_overflow       // The push channel is full, see overflow_policy.
+, channel_closed      // The push channel was closed.
+, simple_error        // The server replied to the command with a simple error.
+, blob_error          // The server replied to the command with a blob error.
+, response_count      // The number of responses differs from the number of commands.
+, slot_count          // The number of values differs from the slots of a prepared command.
+, unsolicited_reply   // A reply that is not a push arrived with no command waiting for it.
+};
+
+class error_category_impl : public boost::system::error_category {
+public:
+   char const* name() const noexcept override
+      { return "aedis.resp"; }
+
+   std::string message(int ev) const override
+   {
+      switch (static_cast<error>(ev)) {
+	 case error::unexpected_type: return "Unexpected type for the response.";
+	 case error::invalid_type: return "Invalid RESP3 type.";
+	 case error::invalid_header: return "Invalid header length.";
+	 case error::push_overflow: return "Push channel overflow.";
+	 case error::channel_closed: return "Push channel closed.";
+	 case error::simple_error: return "Simple error received.";
+	 case error::blob_error: return "Blob error received.";
+	 case error::response_count: return "The number of responses does not match the commands.";
+	 case error::slot_count: return "The number of values does not match the slots.";
+	 case error::unsolicited_reply: return "Reply received with no command waiting for it.";
+	 default: return "Unknown error.";
+      }
+   }
+};
+
+inline
+boost::system::error_category const& error_category()
+{
+   static error_category_impl instance;
+   return instance;
+}
+
+inline
+boost::system::error_code make_error_code(error e)
+   { return {static_cast<int>(e), error_category()}; }
+
+} // resp
+} // aedis
+
+namespace boost { namespace system {
+
+template <>
+struct is_error_code_enum<aedis::resp::error> : std::true_type {};
+
+} // system
+} // boost
@@ -0,0 +1,123 @@
+/* Copyright (c) 2019 - 2021 Marcelo Zimbres Silva (mzimbres at gmail dot com)
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#pragma once
+
+#include <bit>
+#include <array>
+#include <tuple>
+#include <cstdint>
+#include <utility>
+#include <string_view>
+#include <type_traits>
+
+namespace aedis { namespace resp {
+
+// A struct member stored in a redis hash under the given name.
+template <class T, class M>
+struct field {
+   std::string_view name;
+   M T::* member;
+};
+
+/* Users describe the fields of a struct stored as a hash by
+ * specializing this trait with a tuple of fields, for example
+ *
+ *    template <>
+ *    struct resp::struct_fields<user> {
+ *       static constexpr auto value = std::make_tuple(
+ *          resp::field {"name", &user::name},
+ *          resp::field {"age", &user::age});
+ *    };
+ */
+template <class T>
+struct struct_fields;
+
+template <class T>
+concept has_fields = requires { struct_fields<T>::value; };
+
+template <class T>
+inline constexpr std::size_t field_count =
+   std::tuple_size_v<std::remove_cvref_t<decltype(struct_fields<T>::value)>>;
+
+template <class T>
+constexpr auto field_names() noexcept
+{
+   return std::apply([](auto const&... f) {
+      return std::array<std::string_view, sizeof...(f)> {f.name...};
+   }, struct_fields<T>::value);
+}
+
+// Calls f(name, member) for each field of obj in declaration order.
+template <class T, class F>
+void for_each_field(T& obj, F f)
+{
+   std::apply([&](auto const&... fs) {
+      (f(fs.name, obj.*(fs.member)), ...);
+   }, struct_fields<std::remove_const_t<T>>::value);
+}
+
+inline
+constexpr std::uint32_t field_hash(std::string_view s, std::uint32_t seed) noexcept
+{
+   std::uint32_t h = 2166136261u ^ seed;
+   for (auto c : s) {
+      h ^= static_cast<unsigned char>(c);
+      h *= 16777619u;
+   }
+   return h;
+}
+
+// A collision free hash table of the field names, found at compile
+// time by trying seeds until no two names fall in the same slot.
+template <std::size_t N>
+struct field_table {
+   static constexpr std::size_t size = std::bit_ceil(2 * N + 1);
+
+   std::uint32_t seed = 0;
+   std::array<int, size> slots {};
+};
+
+template <std::size_t N>
+constexpr field_table<N> make_field_table(std::array<std::string_view, N> const& names)
+{
+   field_table<N> t;
+   for (; t.seed < 100000; ++t.seed) {
+      for (auto& s : t.slots)
+	 s = -1;
+
+      bool ok = true;
+      for (std::size_t i = 0; ok && i < N; ++i) {
+	 auto& s = t.slots[field_hash(names[i], t.seed) & (t.size - 1)];
+	 ok = s == -1;
+	 s = static_cast<int>(i);
+      }
+
+      if (ok)
+	 return t;
+   }
+
+   throw "make_field_table: No perfect hash, are field names unique?";
+}
+
+template <class T>
+inline constexpr auto field_table_v = make_field_table(field_names<T>());
+
+// Returns the position of the field with the given name or -1.
+template <class T>
+int field_index(std::string_view name) noexcept
+{
+   static constexpr auto names = field_names<T>();
+   auto const& t = field_table_v<T>;
+   auto const i = t.slots[field_hash(name, t.seed) & (t.size - 1)];
+   if (i < 0 || names[i] != name)
+      return -1;
+   return i;
+}
+
+} // resp
+} // aedis
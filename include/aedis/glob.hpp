@@ -0,0 +1,183 @@
+/* Copyright (c) 2019 - 2021 Marcelo Zimbres Silva (mzimbres at gmail dot com)
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#pragma once
+
+#include <bitset>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <string_view>
+
+namespace aedis { namespace resp {
+
+/* A glob pattern with the syntax of PSUBSCRIBE, compiled once so that
+ * matching does not parse it again
+ *
+ *    h?llo     matches hello, hallo and hxllo
+ *    h*llo     matches hllo and heeeello
+ *    h[ae]llo  matches hello and hallo, but not hillo
+ *    h[^e]llo  matches hallo, hbllo, ... but not hello
+ *    h[a-b]llo matches hallo and hbllo
+ *
+ * A backslash escapes the next character.
+ */
+class glob {
+private:
+   enum class kind : std::uint8_t {literal, any_char, any_seq, set};
+
+   struct op {
+      kind k;
+      std::uint32_t begin = 0; // In literals_ or sets_.
+      std::uint32_t size = 0;  // Of the literal.
+   };
+
+   std::string pattern_;
+   std::string literals_;
+   std::vector<std::bitset<256>> sets_;
+   std::vector<op> ops_;
+
+   static auto index(char c) noexcept
+      { return static_cast<unsigned char>(c); }
+
+   void add_literal(char c)
+   {
+      if (std::empty(ops_) || ops_.back().k != kind::literal)
+	 ops_.push_back({kind::literal, static_cast<std::uint32_t>(std::size(literals_))});
+      literals_.push_back(c);
+      ++ops_.back().size;
+   }
+
+   // Compiles the class starting after [, returns the position after ].
+   std::size_t add_set(std::string_view p, std::size_t i)
+   {
+      std::bitset<256> set;
+      auto const negate = i < std::size(p) && p[i] == '^';
+      if (negate)
+	 ++i;
+
+      for (; i < std::size(p) && p[i] != ']'; ++i) {
+	 if (p[i] == '\\' && i + 1 < std::size(p)) {
+	    set.set(index(p[++i]));
+	 } else if (i + 2 < std::size(p) && p[i + 1] == '-' && p[i + 2] != ']') {
+	    auto lo = index(p[i]);
+	    auto hi = index(p[i + 2]);
+	    if (lo > hi)
+	       std::swap(lo, hi);
+	    for (auto c = lo; c <= hi; ++c)
+	       set.set(c);
+	    i += 2;
+	 } else {
+	    set.set(index(p[i]));
+	 }
+      }
+
+      if (negate)
+	 set.flip();
+
+      ops_.push_back({kind::set, static_cast<std::uint32_t>(std::size(sets_))});
+      sets_.push_back(set);
+      return i + 1;
+   }
+
+   // Matches op at s[pos], advancing pos.
+   bool step(op const& o, std::string_view s, std::size_t& pos) const noexcept
+   {
+      switch (o.k) {
+	 case kind::literal:
+	 {
+	    if (std::size(s) - pos < o.size ||
+		s.compare(pos, o.size, literals_.data() + o.begin, o.size) != 0)
+	       return false;
+	    pos += o.size;
+	 } return true;
+	 case kind::any_char:
+	 {
+	    if (pos == std::size(s))
+	       return false;
+	    ++pos;
+	 } return true;
+	 case kind::set:
+	 {
+	    if (pos == std::size(s) || !sets_[o.begin].test(index(s[pos])))
+	       return false;
+	    ++pos;
+	 } return true;
+	 default: return false;
+      }
+   }
+
+public:
+   explicit glob(std::string_view p)
+   : pattern_ {p}
+   {
+      for (std::size_t i = 0; i < std::size(p);) {
+	 switch (p[i]) {
+	    case '*':
+	    {
+	       // Consecutive stars are the same as one.
+	       if (std::empty(ops_) || ops_.back().k != kind::any_seq)
+		  ops_.push_back({kind::any_seq});
+	       ++i;
+	    } break;
+	    case '?': ops_.push_back({kind::any_char}); ++i; break;
+	    case '[': i = add_set(p, i + 1); break;
+	    case '\\':
+	    {
+	       if (i + 1 < std::size(p))
+		  ++i;
+	       add_literal(p[i++]);
+	    } break;
+	    default: add_literal(p[i++]);
+	 }
+      }
+   }
+
+   auto const& pattern() const noexcept { return pattern_; }
+
+   /* Every operation but * consumes a fixed number of characters, so
+    * only the last * needs to be backtracked, the cost is at most
+    * proportional to the product of the sizes.
+    */
+   bool match(std::string_view s) const noexcept
+   {
+      auto const npos = std::size(ops_);
+      std::size_t i = 0;
+      std::size_t pos = 0;
+      std::size_t star = npos;
+      std::size_t star_pos = 0;
+
+      while (i < std::size(ops_) || pos < std::size(s)) {
+	 if (i < std::size(ops_)) {
+	    if (ops_[i].k == kind::any_seq) {
+	       star = i++;
+	       star_pos = pos;
+	       continue;
+	    }
+
+	    auto next = pos;
+	    if (step(ops_[i], s, next)) {
+	       pos = next;
+	       ++i;
+	       continue;
+	    }
+	 }
+
+	 // Lets the last * take one more character.
+	 if (star == npos || star_pos == std::size(s))
+	    return false;
+
+	 i = star + 1;
+	 pos = ++star_pos;
+      }
+
+      return true;
+   }
+};
+
+} // resp
+} // aedis
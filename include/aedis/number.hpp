@@ -0,0 +1,169 @@
+/* Copyright (c) 2019 - 2021 Marcelo Zimbres Silva (mzimbres at gmail dot com)
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#pragma once
+
+#include <bit>
+#include <limits>
+#include <cstdint>
+#include <cstring>
+#include <charconv>
+#include <type_traits>
+
+namespace aedis { namespace resp {
+
+// Converts eight ascii digits loaded in little endian order, i.e. the
+// most significant digit in the lowest byte, to their value.
+inline
+std::uint64_t swar_digits(std::uint64_t v) noexcept
+{
+   v -= 0x3030303030303030;
+   v = (v * 10) + (v >> 8);
+   v = ((v & 0x00FF00FF00FF00FF) * (1 + (100ULL << 16))) >> 16;
+   return ((v & 0x0000FFFF0000FFFF) * (1 + (10000ULL << 32))) >> 32;
+}
+
+// True if all eight bytes are in the range '0'-'9'.
+inline
+bool swar_is_digits(std::uint64_t v) noexcept
+{
+   return
+      ((v & 0xF0F0F0F0F0F0F0F0) |
+      (((v + 0x0606060606060606) & 0xF0F0F0F0F0F0F0F0) >> 4)) ==
+      0x3333333333333333;
+}
+
+// Slow path of parse_integer, kept out of line.
+template <class T>
+[[gnu::noinline, gnu::cold]]
+std::from_chars_result
+parse_integer_fallback(char const* first, char const* last, T& value) noexcept
+   { return std::from_chars(first, last, value); }
+
+/* Converts the decimal integer in [first, last) with the same
+ * semantics as std::from_chars. One to three digits, the usual size
+ * of RESP lengths, are decoded directly, four to seven with a single
+ * SWAR conversion. Longer inputs are decoded eight digits at a time
+ * and the remaining ones in a loop with a single branch per digit.
+ * Inputs it does not handle, for example trailing non-digits or
+ * values that may overflow, are forwarded to std::from_chars.
+ */
+template <class T>
+std::from_chars_result
+parse_integer(char const* first, char const* last, T& value) noexcept
+{
+   static_assert(std::is_integral<T>::value);
+
+   if (auto const n = last - first; n > 0 && n <= 3) [[likely]] {
+      unsigned r = static_cast<unsigned char>(first[0] - '0');
+      bool invalid = r > 9;
+      for (auto const* p = first + 1; p != last; ++p) {
+	 unsigned const d = static_cast<unsigned char>(*p - '0');
+	 invalid |= d > 9;
+	 r = 10 * r + d;
+      }
+
+      if (!invalid && r <= static_cast<unsigned>(std::numeric_limits<T>::max())) [[likely]] {
+	 value = static_cast<T>(r);
+	 return {last, std::errc{}};
+      }
+   }
+
+   if constexpr (std::endian::native != std::endian::little) {
+      return std::from_chars(first, last, value);
+   } else {
+      // Unsigned four to seven digits, padded as below.
+      if (auto const n = last - first; n >= 4 && n <= 7) {
+	 std::uint32_t a, b;
+	 std::memcpy(&a, first, 4);
+	 std::memcpy(&b, last - 4, 4);
+	 auto const v =
+	    (0x3030303030303030 >> (8 * n)) |
+	    (std::uint64_t {a} << (8 * (8 - n))) |
+	    (std::uint64_t {b} << 32);
+
+	 if (swar_is_digits(v)) {
+	    auto const r = swar_digits(v);
+	    if (r <= static_cast<std::uint64_t>(std::numeric_limits<T>::max())) {
+	       value = static_cast<T>(r);
+	       return {last, std::errc{}};
+	    }
+	 }
+      }
+
+      auto const* p = first;
+      bool const neg = p != last && *p == '-';
+      if (neg)
+	 ++p;
+
+      // 19 digits always fit in 64 bits.
+      auto const n = last - p;
+      if (n == 0 || n > 19 || (neg && std::is_unsigned<T>::value))
+	 return parse_integer_fallback(first, last, value);
+
+      std::uint64_t r = 0;
+      for (; last - p >= 8; p += 8) {
+	 std::uint64_t v;
+	 std::memcpy(&v, p, 8);
+	 if (!swar_is_digits(v))
+	    return parse_integer_fallback(first, last, value);
+	 r = 100000000 * r + swar_digits(v);
+      }
+
+      // Four to seven remaining digits are assembled in a word padded
+      // with '0' on the left, using two overlapping loads, so that the
+      // same conversion applies. Fewer digits are cheaper in a loop.
+      if (auto const rem = last - p; rem >= 4) {
+	 std::uint32_t a, b;
+	 std::memcpy(&a, p, 4);
+	 std::memcpy(&b, last - 4, 4);
+	 auto const v =
+	    (0x3030303030303030 >> (8 * rem)) |
+	    (std::uint64_t {a} << (8 * (8 - rem))) |
+	    (std::uint64_t {b} << 32);
+
+	 if (!swar_is_digits(v))
+	    return parse_integer_fallback(first, last, value);
+
+	 static constexpr std::uint64_t pow10[] =
+	    {1, 10, 100, 1000, 10000, 100000, 1000000, 10000000};
+	 r = pow10[rem] * r + swar_digits(v);
+      } else {
+	 bool invalid = false;
+	 for (; p != last; ++p) {
+	    auto const d = static_cast<unsigned char>(*p - '0');
+	    invalid |= d > 9;
+	    r = 10 * r + d;
+	 }
+
+	 if (invalid)
+	    return parse_integer_fallback(first, last, value);
+      }
+
+      // Every character is a digit here, so std::from_chars would
+      // point past all of them on overflow as well.
+      using limits = std::numeric_limits<T>;
+      if constexpr (std::is_signed<T>::value) {
+	 if (neg) {
+	    if (r > static_cast<std::uint64_t>(limits::max()) + 1)
+	       return {last, std::errc::result_out_of_range};
+	    value = static_cast<T>(0 - r);
+	    return {last, std::errc{}};
+	 }
+      }
+
+      if (r > static_cast<std::uint64_t>(limits::max()))
+	 return {last, std::errc::result_out_of_range};
+
+      value = static_cast<T>(r);
+
+      return {last, std::errc{}};
+   }
+}
+
+} // resp
+} // aedis
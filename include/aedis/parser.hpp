@@ -7,26 +7,43 @@
 
 #pragma once
 
+#include <array>
+#include <algorithm>
+#include <span>
+#include <concepts>
 #include <string>
+#include <tuple>
+#include <vector>
+#include <limits>
+#include <optional>
+#include <utility>
 #include <cstdio>
 #include <cstring>
 #include <numeric>
 #include <type_traits>
+#include <string_view>
 #include <charconv>
 
 #include "type.hpp"
+#include "error.hpp"
+#include "number.hpp"
+#include "scanner.hpp"
 
 namespace aedis { namespace resp {
 
-// Converts a decimal number in ascii format to an integer.
+// Converts the length in a header line like "*10\r\n" or "$-1\r\n",
+// where n is the size of the line including the separator. Malformed
+// lengths are reported in ec.
 inline
-long long length(char const* p)
+long long
+length(char const* data, std::size_t n, boost::system::error_code& ec)
 {
    long long len = 0;
-   while (*p != '\r') {
-       len = (10 * len) + (*p - '0');
-       p++;
-   }
+   auto const* last = data + n - 2;
+   auto const r = parse_integer(data + 1, last, len);
+   if (r.ec != std::errc{} || r.ptr != last)
+      ec = error::invalid_header;
+
    return len;
 }
 
@@ -38,63 +55,293 @@ enum class bulk_type
 , none
 };
 
+/* Number of elements still expected at each nesting level. The first
+ * N levels are stored inline so that usual replies don't allocate,
+ * deeper levels spill over into a vector that is kept once grown.
+ */
+template <std::size_t N>
+class size_stack {
+private:
+   std::array<int, N> inline_;
+   std::vector<int> spill_;
+
+public:
+   int& operator[](int i) noexcept
+   {
+      if (static_cast<std::size_t>(i) < N) [[likely]]
+	 return inline_[i];
+      return spill_[i - N];
+   }
+
+   int operator[](int i) const noexcept
+   {
+      if (static_cast<std::size_t>(i) < N) [[likely]]
+	 return inline_[i];
+      return spill_[i - N];
+   }
+
+   // Makes room for level i, the levels below it are kept.
+   void reserve(int i)
+   {
+      if (static_cast<std::size_t>(i) >= N + std::size(spill_))
+	 spill_.resize(i - N + 1);
+   }
+};
+
+// The types a response passes to the parser, all of them unless it
+// declares a supported_types member.
+template <class Response>
+constexpr type_set response_types() noexcept
+{
+   if constexpr (requires { Response::supported_types; })
+      return Response::supported_types;
+   else
+      return all_types;
+}
+
+/* Responses that implement on_blob_string_chunk(s, last) receive the
+ * payload of blob strings as it arrives instead of once it has been
+ * read completely, so that values of any size are read with bounded
+ * memory. The chunks have at most chunk_size() bytes, when the
+ * response defines it, and last is true on the final one.
+ */
+template <class Response>
+concept streams_blob_strings =
+   requires (Response& r, std::string_view s) { r.on_blob_string_chunk(s, true); };
+
+/* Responses that implement blob_string_buffer(n) provide the memory the
+ * n bytes of a blob string payload are read into, for example the tail
+ * of a string or a mapped file. Bytes that were already buffered are
+ * copied there, the rest is read from the stream directly into it.
+ * on_blob_string is then called with a view of that memory. Returning
+ * null reads the payload as usual.
+ */
+template <class Response>
+concept provides_blob_buffers =
+   requires (Response& r, std::size_t n) { { r.blob_string_buffer(n) } -> std::convertible_to<char*>; };
+
 template <class Response>
+std::size_t blob_chunk_size(Response const& r) noexcept
+{
+   if constexpr (requires { r.chunk_size(); })
+      return std::max<std::size_t>(r.chunk_size(), 1);
+   else
+      return 16384;
+}
+
+// Dispatches an element whose type the response may not support, the
+// branch is dropped at compile time when it does not.
+#define AEDIS_PARSER_CASE(t, expr) \
+   case type::t: \
+      if constexpr (accepts(type::t)) { expr; } \
+      else { on_unsupported(type::t); } \
+      break
+
+/* Parses a single top-level RESP3 element into a response adapter.
+ *
+ * The parser does not depend on Asio, it can be driven in three ways
+ *
+ *    1. advance: one complete line or bulk payload at a time.
+ *    2. parse: all complete elements in a buffer, the caller keeps the
+ *       bytes that were not consumed and passes them again with more
+ *       data appended.
+ *    3. feed: arbitrary fragments, partial lines and bulks are kept
+ *       internally.
+ *
+ * Elements of a type not in the supported_types of the response stop
+ * the parser with error::unexpected_type and malformed lengths with
+ * error::invalid_header, see ec(). Depth is the nesting depth handled
+ * without allocating, deeper replies are supported as well.
+ */
+template <class Response, std::size_t Depth = 8>
 class parser {
 public:
 private:
+   template <class, std::size_t> friend class parser;
+
+   static constexpr bool accepts(type t) noexcept
+      { return contains(response_types<Response>(), t); }
+
+   static constexpr bool streams = streams_blob_strings<Response>;
+   static constexpr bool fills = !streams && provides_blob_buffers<Response>;
+
+   void on_unsupported(type)
+      { ec_ = error::unexpected_type; }
+
    Response* res_;
    int depth_;
-   int sizes_[6]; // Streaming will require a bigger integer.
+   size_stack<Depth> sizes_;
    bulk_type bulk_;
-   int bulk_length_;
+   long long bulk_length_;
+   separator_index index_;
+
+   // Payload bytes of the blob string being streamed that have been
+   // delivered, or written to target_.
+   std::size_t bulk_offset_;
+
+   // The memory provided by the response for the blob string being
+   // read, see provides_blob_buffers.
+   char* target_;
+
+   // The level of the streamed string being read, zero if none. The
+   // response does not select it, so it is not popped either.
+   int streamed_depth_;
+
+   // Incomplete element passed to feed.
+   std::string carry_;
+
+   boost::system::error_code ec_;
+
+   void enter_aggregate(int size)
+   {
+      sizes_.reserve(++depth_);
+      sizes_[depth_] = size;
+   }
 
    void init(Response* res)
    {
       res_ = res;
       depth_ = 0;
-      sizes_[0] = 2;
-      sizes_[1] = 1;
-      sizes_[2] = 1;
-      sizes_[3] = 1;
-      sizes_[4] = 1;
-      sizes_[5] = 1;
-      sizes_[6] = 1;
+      sizes_[0] = 1;
+      bulk_ = bulk_type::none;
+      bulk_length_ = std::numeric_limits<long long>::max();
+      bulk_offset_ = 0;
+      target_ = nullptr;
+      streamed_depth_ = 0;
+   }
+
+   void pop_finished()
+   {
+      while (depth_ != 0 && sizes_[depth_] == 0) {
+	 if (depth_ == streamed_depth_)
+	    streamed_depth_ = 0;
+	 else
+	    res_->pop();
+	 --sizes_[--depth_];
+      }
+   }
+
+   void on_chunks(std::string_view s, bool last)
+   {
+      auto const c = blob_chunk_size(*res_);
+      for (; std::size(s) > c; s.remove_prefix(c))
+	 res_->on_blob_string_chunk(s.substr(0, c), false);
+
+      if (last || !std::empty(s))
+	 res_->on_blob_string_chunk(s, last);
+   }
+
+   // Delivers the payload bytes of the streamed blob string that are
+   // in data, the last chunk once its separator has arrived as well.
+   // Returns the number of bytes consumed.
+   std::size_t stream_bulk(char const* data, std::size_t n)
+   {
+      auto const remaining = static_cast<std::size_t>(bulk_length_) - bulk_offset_;
+      if (n >= remaining + 2) {
+	 on_chunks({data, remaining}, true);
+	 bulk_offset_ = 0;
+	 bulk_ = bulk_type::none;
+	 --sizes_[depth_];
+	 pop_finished();
+	 return remaining + 2;
+      }
+
+      // At least one byte is kept for the last chunk.
+      auto const k = std::min(n, remaining == 0 ? 0 : remaining - 1);
+      on_chunks({data, k}, false);
+      bulk_offset_ += k;
+      return k;
+   }
+
+   // Copies the payload bytes in data to the memory provided by the
+   // response, the blob string is complete once its separator arrived.
+   // Returns the number of bytes consumed.
+   std::size_t fill_bulk(char const* data, std::size_t n)
+   {
+      auto const length = static_cast<std::size_t>(bulk_length_);
+      auto const k = std::min(n, length - bulk_offset_);
+      if (k != 0)
+	 std::memcpy(target_ + bulk_offset_, data, k);
+      bulk_offset_ += k;
+
+      if (bulk_offset_ != length || n - k < 2)
+	 return k;
+
+      res_->on_blob_string({target_, length});
+      bulk_offset_ = 0;
+      target_ = nullptr;
       bulk_ = bulk_type::none;
-      bulk_length_ = std::numeric_limits<int>::max();
+      --sizes_[depth_];
+      pop_finished();
+      return k + 2;
    }
 
-   auto on_array_impl(char const* data, int m = 1)
+   // Returns the number of elements or -1 on a RESP2 null aggregate
+   // and on a malformed header. The number of elements is kept in an
+   // int, larger counts are rejected as malformed.
+   long long on_array_impl(char const* data, std::size_t n, int m = 1)
    {
-      auto const l = length(data + 1);
+      auto const l = length(data, n, ec_);
+      if (!ec_ && l > std::numeric_limits<int>::max() / m)
+	 ec_ = error::invalid_header;
+
+      if (ec_)
+	 return -1;
+
+      if (l < 0) {
+	 on_null();
+	 return l;
+      }
+
       if (l == 0) {
 	 --sizes_[depth_];
 	 return l;
       }
 
       auto const size = m * l;
-      sizes_[++depth_] = size;
+      enter_aggregate(size);
       return size;
    }
 
-   void on_array(char const* data)
-      { res_->select_array(on_array_impl(data, 1)); }
+   // Selects the aggregate in the response. Empty aggregates have no
+   // elements that would close them, so they are popped right away.
+   template <class Select>
+   void on_aggregate(char const* data, std::size_t n, int m, Select select)
+   {
+      auto const l = on_array_impl(data, n, m);
+      if (l < 0)
+	 return;
+
+      select(l);
+      if (l == 0)
+	 res_->pop();
+   }
 
-   void on_push(char const* data)
-      { res_->select_push(on_array_impl(data, 1)); }
+   void on_array(char const* data, std::size_t n)
+      { on_aggregate(data, n, 1, [this](auto l) { res_->select_array(l); }); }
 
-   void on_set(char const* data)
-      { res_->select_set(on_array_impl(data, 1)); }
+   void on_push(char const* data, std::size_t n)
+      { on_aggregate(data, n, 1, [this](auto l) { res_->select_push(l); }); }
 
-   void on_map(char const* data)
-      { res_->select_map(on_array_impl(data, 2)); }
+   void on_set(char const* data, std::size_t n)
+      { on_aggregate(data, n, 1, [this](auto l) { res_->select_set(l); }); }
 
-   void on_attribute(char const* data)
-      { res_->select_attribute(on_array_impl(data, 2)); }
+   void on_map(char const* data, std::size_t n)
+      { on_aggregate(data, n, 2, [this](auto l) { res_->select_map(l); }); }
 
+   void on_attribute(char const* data, std::size_t n)
+      { on_aggregate(data, n, 2, [this](auto l) { res_->select_attribute(l); }); }
+
+   // An unsupported null is not counted, like any element that stops
+   // the parser.
    void on_null()
    {
-      res_->on_null();
-      --sizes_[depth_];
+      if constexpr (accepts(type::null)) {
+	 res_->on_null();
+	 --sizes_[depth_];
+      } else {
+	 on_unsupported(type::null);
+      }
    }
 
    auto handle_simple_string(char const* data, std::size_t n)
@@ -124,101 +371,541 @@ private:
    void on_bulk(bulk_type b, std::string_view s = {})
    {
       switch (b) {
-	 case bulk_type::blob_error: res_->on_blob_error(s); break;
-	 case bulk_type::verbatim_string: res_->on_verbatim_string(s); break;
-	 case bulk_type::blob_string: res_->on_blob_string(s); break;
+	 // The header of unsupported types is rejected before.
+	 case bulk_type::blob_error:
+	    if constexpr (accepts(type::blob_error))
+	       res_->on_blob_error(s);
+	    break;
+	 case bulk_type::verbatim_string:
+	    if constexpr (accepts(type::verbatim_string))
+	       res_->on_verbatim_string(s);
+	    break;
+	 case bulk_type::blob_string:
+	    if constexpr (streams)
+	       on_chunks(s, true);
+	    else if constexpr (accepts(type::blob_string))
+	       res_->on_blob_string(s);
+	    break;
 	 case bulk_type::streamed_string_part:
-         {
-           if (std::empty(s)) {
-              sizes_[depth_] = 1;
-           } else {
-              res_->on_streamed_string_part(s);
-           }
-         } break;
+	    if constexpr (accepts(type::streamed_string_part))
+	       res_->on_streamed_string_part(s);
+	    break;
 	 default: assert(false);
       }
 
       --sizes_[depth_];
    }
 
-   auto on_blob_error_impl(char const* data, bulk_type b)
+   auto on_blob_error_impl(char const* data, std::size_t n, bulk_type b)
    {
-      bulk_length_ = length(data + 1);
+      bulk_length_ = length(data, n, ec_);
+      if (ec_)
+	 return bulk_type::none;
+
+      if (bulk_length_ < 0) {
+	 // RESP2 null bulk, there is no payload.
+	 on_null();
+	 return bulk_type::none;
+      }
+
       return b;
    }
 
-   auto on_streamed_string_size(char const* data)
-      { return on_blob_error_impl(data, bulk_type::streamed_string_part); }
+   auto on_streamed_string_size(char const* data, std::size_t n)
+   {
+      auto const b = on_blob_error_impl(data, n, bulk_type::streamed_string_part);
+      if (!ec_ && bulk_length_ == 0) {
+	 // The terminating ";0\r\n" has no payload.
+	 sizes_[depth_] = 0;
+	 return bulk_type::none;
+      }
 
-   auto on_blob_error(char const* data)
-      { return on_blob_error_impl(data, bulk_type::blob_error); }
+      return b;
+   }
+
+   auto on_blob_error(char const* data, std::size_t n)
+      { return on_blob_error_impl(data, n, bulk_type::blob_error); }
 
-   auto on_verbatim_string(char const* data)
-      { return on_blob_error_impl(data, bulk_type::verbatim_string); }
+   auto on_verbatim_string(char const* data, std::size_t n)
+      { return on_blob_error_impl(data, n, bulk_type::verbatim_string); }
 
-   auto on_blob_string(char const* data)
+   // The header of a streamed string, "$?\r\n", shares the type
+   // byte with blob strings.
+   auto on_blob_string(char const* data, std::size_t n)
    {
       if (*(data + 1) == '?') {
-	 sizes_[++depth_] = std::numeric_limits<int>::max();
+	 if constexpr (!accepts(type::streamed_string_part)) {
+	    on_unsupported(type::streamed_string_part);
+	    return bulk_type::none;
+	 }
+
+	 enter_aggregate(std::numeric_limits<int>::max());
+	 streamed_depth_ = depth_;
+	 return bulk_type::none;
+      }
+
+      if constexpr (!accepts(type::blob_string)) {
+	 on_unsupported(type::blob_string);
 	 return bulk_type::none;
       }
 
-      return on_blob_error_impl(data, bulk_type::blob_string);
+      return on_blob_error_impl(data, n, bulk_type::blob_string);
+   }
+
+   // Appends to the incomplete element the bytes in data it needs to
+   // be complete and parses it. Returns the number of bytes used.
+   std::size_t feed_carry(char const* data, std::size_t n)
+   {
+      auto m = n;
+      if (bulk_ != bulk_type::none) {
+	 auto const l = static_cast<std::size_t>(bulk_length_) - bulk_offset_ + 2;
+	 m = std::min(n, l - std::size(carry_));
+      } else {
+	 // The separator may be split between carry and data.
+	 for (std::size_t i = 0; i < n; ++i) {
+	    auto const* p =
+	       static_cast<char const*>(std::memchr(data + i, '\n', n - i));
+	    if (!p)
+	       break;
+
+	    i = p - data;
+	    auto const prev = i == 0 ? carry_.back() : data[i - 1];
+	    if (prev == '\r') {
+	       m = i + 1;
+	       break;
+	    }
+	 }
+      }
+
+      carry_.append(data, m);
+      carry_.erase(0, parse(std::data(carry_), std::size(carry_)));
+      if (ec_)
+	 return 0;
+
+      return m;
    }
 
 public:
    parser(Response* res)
    { init(res); }
 
+   // Continues the reply other stopped at with error::unexpected_type,
+   // its remaining elements, starting with the one other did not
+   // support, are parsed into res. other must have been driven with
+   // parse or advance.
+   template <class Other>
+   parser(Response* res, parser<Other, Depth> const& other)
+   {
+      init(res);
+      depth_ = other.depth_;
+      sizes_ = other.sizes_;
+      streamed_depth_ = other.streamed_depth_;
+   }
+
    std::size_t advance(char const* data, std::size_t n)
    {
       auto next = bulk_type::none;
       if (bulk_ != bulk_type::none) {
          n = bulk_length_ + 2;
+         if constexpr (fills) {
+            // The response expects the payload in the memory it
+            // provided for it.
+            if (target_)
+               return fill_bulk(data, n);
+         }
          on_bulk(bulk_, {data, (std::size_t)bulk_length_});
       } else {
          if (sizes_[depth_] != 0) {
-            switch (*data) {
-               case '!': next = on_blob_error(data); break;
-               case '=': next = on_verbatim_string(data); break; 
-               case '$': next = on_blob_string(data); break;
-               case ';': next = on_streamed_string_size(data); break;
-               case '-': on_simple_error(data, n); break;
-               case ':': on_number(data, n); break;
-               case ',': on_double(data, n); break;
-               case '#': on_boolean(data, n); break;
-               case '(': on_big_number(data, n); break;
-               case '+': on_simple_string(data, n); break;
-               case '_': on_null(); break;
-               case '>': on_push(data); break;
-               case '~': on_set(data); break;
-               case '*': on_array(data); break;
-               case '|': on_attribute(data); break;
-               case '%': on_map(data); break;
-               default: assert(false);
+            switch (to_type(*data)) {
+               AEDIS_PARSER_CASE(blob_error, next = on_blob_error(data, n));
+               AEDIS_PARSER_CASE(verbatim_string, next = on_verbatim_string(data, n));
+               case type::blob_string:
+                  next = on_blob_string(data, n);
+                  break;
+               AEDIS_PARSER_CASE(streamed_string_part, next = on_streamed_string_size(data, n));
+               AEDIS_PARSER_CASE(simple_error, on_simple_error(data, n));
+               AEDIS_PARSER_CASE(number, on_number(data, n));
+               AEDIS_PARSER_CASE(double_type, on_double(data, n));
+               AEDIS_PARSER_CASE(boolean, on_boolean(data, n));
+               AEDIS_PARSER_CASE(big_number, on_big_number(data, n));
+               AEDIS_PARSER_CASE(simple_string, on_simple_string(data, n));
+               AEDIS_PARSER_CASE(null, on_null());
+               AEDIS_PARSER_CASE(push, on_push(data, n));
+               AEDIS_PARSER_CASE(set, on_set(data, n));
+               AEDIS_PARSER_CASE(array, on_array(data, n));
+               AEDIS_PARSER_CASE(attribute, on_attribute(data, n));
+               AEDIS_PARSER_CASE(map, on_map(data, n));
+               default: ec_ = error::invalid_type;
             }
+
+            if (ec_)
+               return n;
          } else {
 	 }
       }
-      
-      while (sizes_[depth_] == 0) {
-	 res_->pop();
-         --sizes_[--depth_];
-      }
-      
+
+      pop_finished();
       bulk_ = next;
+
+      if constexpr (fills) {
+	 if (bulk_ == bulk_type::blob_string)
+	    target_ = res_->blob_string_buffer(static_cast<std::size_t>(bulk_length_));
+      }
       return n;
    }
 
+   // Parses all complete elements in [data, data + n) and returns the
+   // number of bytes consumed. It stops as soon as the parser is done
+   // so that pipelined replies that follow are not consumed. data must
+   // point to the first byte not consumed by previous calls.
+   std::size_t parse(char const* data, std::size_t n)
+   {
+      std::size_t consumed = 0;
+      do {
+	 std::string_view const v {data + consumed, n - consumed};
+	 std::size_t m = 0;
+	 if (bulk_ == bulk_type::none) {
+	    auto const pos = index_.find(std::data(v), std::size(v));
+	    if (pos == separator_index::npos)
+	       return consumed;
+	    m = pos + 2;
+	 } else {
+	    if constexpr (streams || fills) {
+	       if (bulk_ == bulk_type::blob_string && (streams || target_)) {
+		  if constexpr (streams)
+		     m = stream_bulk(std::data(v), std::size(v));
+		  else
+		     m = fill_bulk(std::data(v), std::size(v));
+
+		  index_.consume(m);
+		  consumed += m;
+		  if (bulk_ != bulk_type::none)
+		     return consumed;
+		  continue;
+	       }
+	    }
+
+	    m = static_cast<std::size_t>(bulk_length_) + 2;
+	    if (std::size(v) < m)
+	       return consumed;
+	 }
+
+	 m = advance(std::data(v), m);
+	 if (ec_)
+	    return consumed;
+
+	 index_.consume(m);
+	 consumed += m;
+      } while (!done());
+
+      return consumed;
+   }
+
+   // Parses the fragment [data, data + n), which may end in the middle
+   // of a line or bulk. Returns the number of bytes consumed, that is
+   // n unless the parser is done before the end of the fragment.
+   // Complete elements are parsed in place, only an incomplete element
+   // at the end of the fragment is copied.
+   std::size_t feed(char const* data, std::size_t n)
+   {
+      std::size_t consumed = 0;
+      if (!std::empty(carry_)) {
+	 consumed = feed_carry(data, n);
+	 if (!std::empty(carry_) || done() || ec_)
+	    return consumed;
+      }
+
+      consumed += parse(data + consumed, n - consumed);
+      if (!done() && !ec_) {
+	 carry_.assign(data + consumed, n - consumed);
+	 consumed = n;
+      }
+
+      return consumed;
+   }
+
+   // True when a complete top-level element has been parsed.
    auto done() const noexcept
-     { return depth_ == 0 && bulk_ == bulk_type::none; }
+     { return depth_ == 0 && sizes_[0] == 0 && bulk_ == bulk_type::none; }
+
+   // The error that stopped the parser, the element that caused it is
+   // not consumed.
+   auto const& ec() const noexcept
+     { return ec_; }
 
    auto bulk() const noexcept
      { return bulk_; }
 
    auto bulk_length() const noexcept
      { return bulk_length_; }
+
+   // The number of bytes to read next while a blob string is being
+   // streamed or read into the memory of the response, zero when it
+   // is read whole.
+   std::size_t bulk_chunk() const noexcept
+   {
+      if constexpr (streams || fills) {
+	 if (bulk_ == bulk_type::blob_string && (streams || target_))
+	    return blob_chunk_size(*res_);
+      }
+      return 0;
+   }
+
+   // The part of the memory provided by the response for the blob
+   // string being read that is still missing, empty otherwise. Bytes
+   // read into it directly are reported with commit_bulk.
+   std::span<char> bulk_target() const noexcept
+   {
+      if (!target_)
+	 return {};
+      return {target_ + bulk_offset_, static_cast<std::size_t>(bulk_length_) - bulk_offset_};
+   }
+
+   void commit_bulk(std::size_t n) noexcept
+      { bulk_offset_ += n; }
+};
+
+/* Parses consecutive top-level elements into the responses of a
+ * tuple, one element per response, with the same interface as
+ * parser.
+ */
+template <class... Responses>
+class tuple_parser {
+private:
+   std::tuple<parser<Responses>...> parsers_;
+   std::size_t i_ = 0;
+   bulk_type bulk_ = bulk_type::none;
+   long long bulk_length_ = 0;
+   std::size_t bulk_chunk_ = 0;
+   boost::system::error_code ec_;
+
+   template <std::size_t... Is>
+   tuple_parser(std::tuple<Responses...>* res, std::index_sequence<Is...>)
+   : parsers_ {&std::get<Is>(*res)...}
+   { }
+
+   // Calls f with the parser of the current element.
+   template <class F, std::size_t... Is>
+   void visit(F&& f, std::index_sequence<Is...>)
+      { ((i_ == Is ? f(std::get<Is>(parsers_)) : void()), ...); }
+
+   template <class F, std::size_t... Is>
+   void visit(F&& f, std::index_sequence<Is...>) const
+      { ((i_ == Is ? f(std::get<Is>(parsers_)) : void()), ...); }
+
+public:
+   tuple_parser(std::tuple<Responses...>* res)
+   : tuple_parser(res, std::index_sequence_for<Responses...> {})
+   { }
+
+   std::size_t parse(char const* data, std::size_t n)
+   {
+      std::size_t consumed = 0;
+      while (!done()) {
+	 bool finished = false;
+	 visit([&](auto& p) {
+	    consumed += p.parse(data + consumed, n - consumed);
+	    finished = p.done();
+	    bulk_ = p.bulk();
+	    bulk_length_ = p.bulk_length();
+	    bulk_chunk_ = p.bulk_chunk();
+	    ec_ = p.ec();
+	 }, std::index_sequence_for<Responses...> {});
+
+	 if (!finished)
+	    break;
+
+	 ++i_;
+      }
+
+      return consumed;
+   }
+
+   // True when all responses have been parsed.
+   auto done() const noexcept
+     { return i_ == sizeof...(Responses); }
+
+   auto const& ec() const noexcept
+     { return ec_; }
+
+   auto bulk() const noexcept
+     { return bulk_; }
+
+   auto bulk_length() const noexcept
+     { return bulk_length_; }
+
+   auto bulk_chunk() const noexcept
+     { return bulk_chunk_; }
+
+   std::span<char> bulk_target() const noexcept
+   {
+      std::span<char> ret;
+      if (!done())
+	 visit([&](auto const& p) { ret = p.bulk_target(); }, std::index_sequence_for<Responses...> {});
+      return ret;
+   }
+
+   void commit_bulk(std::size_t n) noexcept
+      { visit([&](auto& p) { p.commit_bulk(n); }, std::index_sequence_for<Responses...> {}); }
+};
+
+// Reads n consecutive replies into the same response, see
+// repeated_parser. With stop_at_push, reading also stops before a
+// push that arrives between them, so that it can be routed elsewhere.
+// read is the number of replies that were read.
+template <class Response>
+struct repeated {
+   Response* res;
+   std::size_t n;
+   bool stop_at_push = false;
+   std::size_t read = 0;
+};
+
+template <class Response>
+class repeated_parser {
+private:
+   repeated<Response>* r_;
+   parser<Response> parser_;
+   std::size_t remaining_;
+
+   // Whether bytes of the current reply have been consumed.
+   bool started_ = false;
+   bool at_push_ = false;
+
+public:
+   repeated_parser(repeated<Response>* r)
+   : r_ {r}
+   , parser_ {r->res}
+   , remaining_ {r->n}
+   { }
+
+   std::size_t parse(char const* data, std::size_t n)
+   {
+      std::size_t consumed = 0;
+      while (remaining_ != 0) {
+	 if (r_->stop_at_push && !started_ && consumed != n &&
+	     to_type(data[consumed]) == type::push) {
+	    at_push_ = true;
+	    break;
+	 }
+
+	 auto const m = parser_.parse(data + consumed, n - consumed);
+	 consumed += m;
+	 started_ = started_ || m != 0;
+	 if (!parser_.done())
+	    break;
+
+	 ++r_->read;
+	 started_ = false;
+	 if (--remaining_ != 0)
+	    parser_ = parser<Response> {r_->res};
+      }
+
+      return consumed;
+   }
+
+   // True when all replies have been parsed or a push is next.
+   auto done() const noexcept
+     { return remaining_ == 0 || at_push_; }
+
+   auto const& ec() const noexcept
+     { return parser_.ec(); }
+
+   auto bulk() const noexcept
+     { return parser_.bulk(); }
+
+   auto bulk_length() const noexcept
+     { return parser_.bulk_length(); }
+
+   auto bulk_chunk() const noexcept
+     { return parser_.bulk_chunk(); }
+
+   auto bulk_target() const noexcept
+     { return parser_.bulk_target(); }
+
+   void commit_bulk(std::size_t n) noexcept
+     { parser_.commit_bulk(n); }
 };
 
+/* Reads a reply into res. From the first element res does not support
+ * on the rest of the reply is read into fallback instead, see
+ * fallback_parser.
+ */
+template <class Response, class Fallback>
+struct with_fallback {
+   Response* res;
+   Fallback* fallback;
+};
+
+/* Parses a reply like parser<Response> but does not stop at elements
+ * the response does not support. The first one and the rest of the
+ * reply are parsed into the fallback, so that the reply is consumed
+ * whole, and error::unexpected_type is reported once it is. Other
+ * errors stop the parser as usual.
+ */
+template <class Response, class Fallback>
+class fallback_parser {
+private:
+   Fallback* fallback_;
+   parser<Response> parser_;
+   std::optional<parser<Fallback>> rest_;
+
+public:
+   fallback_parser(with_fallback<Response, Fallback>* r)
+   : fallback_ {r->fallback}
+   , parser_ {r->res}
+   { }
+
+   std::size_t parse(char const* data, std::size_t n)
+   {
+      std::size_t consumed = 0;
+      if (!rest_) {
+	 consumed = parser_.parse(data, n);
+	 if (parser_.ec() != error::unexpected_type)
+	    return consumed;
+
+	 rest_.emplace(fallback_, parser_);
+      }
+
+      return consumed + rest_->parse(data + consumed, n - consumed);
+   }
+
+   auto done() const noexcept
+     { return rest_ ? rest_->done() : parser_.done(); }
+
+   boost::system::error_code ec() const noexcept
+   {
+      if (!rest_)
+	 return parser_.ec();
+
+      if (rest_->ec() || !rest_->done())
+	 return rest_->ec();
+
+      return error::unexpected_type;
+   }
+
+   auto bulk() const noexcept
+     { return rest_ ? rest_->bulk() : parser_.bulk(); }
+
+   auto bulk_length() const noexcept
+     { return rest_ ? rest_->bulk_length() : parser_.bulk_length(); }
+
+   auto bulk_chunk() const noexcept
+     { return rest_ ? rest_->bulk_chunk() : parser_.bulk_chunk(); }
+
+   auto bulk_target() const noexcept
+     { return rest_ ? rest_->bulk_target() : parser_.bulk_target(); }
+
+   void commit_bulk(std::size_t n) noexcept
+   {
+      if (rest_)
+	 rest_->commit_bulk(n);
+      else
+	 parser_.commit_bulk(n);
+   }
+};
+
+#undef AEDIS_PARSER_CASE
+
 } // resp
 } // aedis
@@ -0,0 +1,101 @@
+/* Copyright (c) 2019 - 2021 Marcelo Zimbres Silva (mzimbres at gmail dot com)
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#pragma once
+
+#include <vector>
+#include <string>
+#include <cstring>
+#include <string_view>
+#include <type_traits>
+
+#include <boost/system/system_error.hpp>
+
+#include "error.hpp"
+#include "request.hpp"
+
+namespace aedis { namespace resp {
+
+// Marks an argument of a prepared command that is given on each append.
+struct slot_t {};
+inline constexpr slot_t slot {};
+
+/* A command whose fixed arguments are encoded once. Appending it to a
+ * request copies the encoded parts and writes only the arguments
+ * given for the slots, for example
+ *
+ *    resp::prepared incr {command::hincrby, "HINCRBY", resp::slot, "visits", 1};
+ *    for (auto const& key : keys)
+ *       incr.append(req, key);
+ *
+ * Slots take strings and numbers like the other arguments. Appending
+ * a number of values other than the number of slots throws
+ * error::slot_count.
+ */
+class prepared {
+private:
+   command cmd_;
+   std::string fixed_;
+
+   // Offsets in fixed_ where the slot arguments are inserted.
+   std::vector<std::size_t> cuts_;
+
+   template <class T>
+   void add(T const& v)
+   {
+      if constexpr (std::is_same_v<T, slot_t>) {
+	 cuts_.push_back(std::size(fixed_));
+      } else {
+	 trim_to(fixed_, write_arg(append_uninitialized(fixed_, arg_size(v)), v));
+      }
+   }
+
+public:
+   template <class... Args>
+   prepared(command cmd, std::string_view name, Args const&... args)
+   : cmd_ {cmd}
+   {
+      make_header(fixed_, 1 + sizeof...(args));
+      make_bulk(fixed_, name);
+      (add(args), ...);
+   }
+
+   auto cmd() const noexcept { return cmd_; }
+   auto slots() const noexcept { return std::size(cuts_); }
+
+   template <class Event, class... Values>
+   void append(request<Event>& req, Event e, Values const&... values) const
+   {
+      if (sizeof...(values) != std::size(cuts_))
+	 throw boost::system::system_error {make_error_code(error::slot_count)};
+
+      auto* p = append_uninitialized(
+	 req.payload, std::size(fixed_) + (arg_size(values) + ... + 0));
+
+      std::size_t offset = 0;
+      std::size_t i = 0;
+      auto put = [&](auto const& v) {
+	 auto const cut = cuts_[i++];
+	 std::memcpy(p, fixed_.data() + offset, cut - offset);
+	 p += cut - offset;
+	 offset = cut;
+	 p = write_arg(p, v);
+      };
+
+      (put(values), ...);
+      std::memcpy(p, fixed_.data() + offset, std::size(fixed_) - offset);
+      trim_to(req.payload, p + std::size(fixed_) - offset);
+      req.events.push({cmd_, e});
+   }
+
+   template <class Event, class... Values>
+   void append(request<Event>& req, Values const&... values) const
+      { append(req, Event::ignore, values...); }
+};
+
+} // resp
+} // aedis
@@ -0,0 +1,165 @@
+/* Copyright (c) 2019 - 2021 Marcelo Zimbres Silva (mzimbres at gmail dot com)
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <utility>
+#include <stdexcept>
+
+#include <boost/asio.hpp>
+
+#include "error.hpp"
+#include "ring_queue.hpp"
+
+namespace aedis { namespace resp {
+
+// What the reader does with a push that arrives when the channel is
+// full.
+enum class overflow_policy
+{ drop_oldest // Discards the oldest push in the channel.
+, block       // Stops reading until the consumer makes room.
+, disconnect  // Reading fails with error::push_overflow.
+};
+
+/* A bounded queue of the server pushes, for example pub/sub messages
+ * and invalidations, that consumers wait on independently of the
+ * command replies
+ *
+ *    resp::push_channel pushes {ex, {256, resp::overflow_policy::drop_oldest}};
+ *    co_spawn(ex, conn.run(recv, &pushes), net::detached);
+ *    for (;;) {
+ *       auto msg = co_await pushes.async_receive();
+ *       ...
+ *    }
+ *
+ * Each push is the vector of its leaves, like in response_array. With
+ * drop_oldest and disconnect a slow consumer never stalls the replies
+ * to commands.
+ */
+class push_channel {
+public:
+   struct config {
+      std::size_t capacity = 1024;
+      overflow_policy policy = overflow_policy::drop_oldest;
+   };
+
+private:
+   config cfg_;
+   ring_queue<std::vector<std::string>> queue_;
+
+   // Used as condition variables, see wait. They never expire, so
+   // cancel wakes up all waiters and they need not be rearmed, which
+   // would cancel the waiters that did not wake up yet.
+   net::steady_timer not_empty_;
+   net::steady_timer not_full_;
+
+   std::size_t dropped_ = 0;
+   bool closed_ = false;
+
+   static net::awaitable<void> wait(net::steady_timer& t)
+   {
+      boost::system::error_code ec;
+      co_await t.async_wait(net::redirect_error(net::use_awaitable, ec));
+   }
+
+   bool full() const noexcept
+      { return std::size(queue_) >= cfg_.capacity; }
+
+public:
+   // Throws std::invalid_argument if the capacity is zero.
+   push_channel(net::any_io_executor ex, config cfg)
+   : cfg_ {cfg}
+   , not_empty_ {ex, net::steady_timer::time_point::max()}
+   , not_full_ {ex, net::steady_timer::time_point::max()}
+   {
+      if (cfg_.capacity == 0)
+	 throw std::invalid_argument("push_channel: Capacity must be positive.");
+   }
+
+   push_channel(net::any_io_executor ex)
+   : push_channel {ex, config {}}
+   { }
+
+   /* Moves v into the channel applying the overflow policy. Returns
+    * false when the channel is full and the policy is block, v is left
+    * untouched in that case. Pushes are discarded once the channel is
+    * closed.
+    */
+   bool try_push(std::vector<std::string>& v)
+   {
+      if (closed_)
+	 return true;
+
+      if (full()) {
+	 switch (cfg_.policy) {
+	    case overflow_policy::drop_oldest:
+	    {
+	       queue_.pop();
+	       ++dropped_;
+	    } break;
+	    case overflow_policy::block: return false;
+	    case overflow_policy::disconnect:
+	       throw boost::system::system_error {make_error_code(error::push_overflow)};
+	 }
+      }
+
+      queue_.push(std::move(v));
+      not_empty_.cancel();
+      return true;
+   }
+
+   // Like try_push but waits for room when the policy is block.
+   net::awaitable<void> async_push(std::vector<std::string>& v)
+   {
+      while (!try_push(v))
+	 co_await wait(not_full_);
+   }
+
+   // Moves the oldest push into v, returns false if there is none.
+   bool try_receive(std::vector<std::string>& v)
+   {
+      if (std::empty(queue_))
+	 return false;
+
+      v = std::move(queue_.front());
+      queue_.pop();
+      not_full_.cancel();
+      return true;
+   }
+
+   /* Waits for the next push. Once the channel is closed the pushes
+    * left are still delivered, then error::channel_closed is thrown.
+    */
+   net::awaitable<std::vector<std::string>> async_receive()
+   {
+      std::vector<std::string> v;
+      while (!try_receive(v)) {
+	 if (closed_)
+	    throw boost::system::system_error {make_error_code(error::channel_closed)};
+	 co_await wait(not_empty_);
+      }
+      co_return v;
+   }
+
+   // Wakes up the consumers and the reader, called when reading stops.
+   void close()
+   {
+      closed_ = true;
+      not_empty_.cancel();
+      not_full_.cancel();
+   }
+
+   auto size() const noexcept { return std::size(queue_); }
+   auto capacity() const noexcept { return cfg_.capacity; }
+   auto dropped() const noexcept { return dropped_; }
+   bool closed() const noexcept { return closed_; }
+};
+
+} // resp
+} // aedis
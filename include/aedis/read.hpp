@@ -8,6 +8,7 @@
 #pragma once
 
 #include <queue>
+#include <tuple>
 #include <string>
 #include <cstdio>
 #include <utility>
@@ -25,6 +26,8 @@
 #include "parser.hpp"
 #include "response.hpp"
 #include "request.hpp"
+#include "read_buffer.hpp"
+#include "push_channel.hpp"
 
 namespace aedis { namespace resp {
 
@@ -44,9 +47,95 @@ void print_command_raw(std::string const& data, int n)
   }
 }
 
-// The parser supports up to 5 levels of nested structures. The first
-// element in the sizes stack is a sentinel and must be different from
-// 1.
+// Minimum number of bytes requested from the stream on each read.
+// Everything that arrives in one read is parsed before the next one
+// is initiated.
+std::size_t constexpr read_chunk_size = 16384;
+
+// Returns a DynamicBuffer_v2 over the storage. Types like
+// read_buffer provide their own dynamic_buffer overload.
+template <class Storage>
+decltype(auto) make_dynamic_buffer(Storage& buf)
+{
+   using net::dynamic_buffer;
+   return dynamic_buffer(buf);
+}
+
+// Returns how many bytes should be read from the stream given that
+// buffered bytes were not enough to make progress.
+template <class Parser>
+std::size_t read_size(Parser const& p, std::size_t buffered)
+{
+   if (p.bulk() == bulk_type::none)
+      return read_chunk_size;
+
+   // Blob strings that are streamed or read into the memory of the
+   // response are read a chunk at a time.
+   if (auto const c = p.bulk_chunk(); c != 0)
+      return c;
+
+   // On a bulk read we can't read until delimiter since the payload
+   // may contain the delimiter itself so we have to read the whole
+   // chunk.
+   auto const missing = static_cast<std::size_t>(p.bulk_length()) + 2 - buffered;
+   return std::max(missing, read_chunk_size);
+}
+
+// Payloads the response provides the memory for are read directly into
+// it when at least this many bytes are missing, smaller ones are read
+// with what follows them and copied.
+std::size_t constexpr direct_read_size = read_chunk_size;
+
+// Lets responses that keep views into the storage, see
+// response_view.hpp, retain the block they are parsed from.
+template <class Storage, class Response>
+void pin(Storage& buf, Response& res)
+{
+   if constexpr (requires { res.pin(buf.segment()); })
+      res.pin(buf.segment());
+   else
+      static_assert(
+	 !requires { res.pin(nullptr); },
+	 "Response views require a read_buffer as storage.");
+}
+
+template <class Storage, class... Responses>
+void pin(Storage& buf, std::tuple<Responses...>& res)
+   { std::apply([&](auto&... r) { (pin(buf, r), ...); }, res); }
+
+template <class Storage, class Response>
+void pin(Storage& buf, repeated<Response>& res)
+   { pin(buf, *res.res); }
+
+template <class Storage, class Response, class Fallback>
+void pin(Storage& buf, with_fallback<Response, Fallback>& res)
+   { pin(buf, *res.res); }
+
+// The parser for a response, a tuple of responses is read from
+// consecutive replies.
+template <class Response>
+struct parser_for {
+   using type = parser<Response>;
+};
+
+template <class... Responses>
+struct parser_for<std::tuple<Responses...>> {
+   using type = tuple_parser<Responses...>;
+};
+
+template <class Response>
+struct parser_for<repeated<Response>> {
+   using type = repeated_parser<Response>;
+};
+
+template <class Response, class Fallback>
+struct parser_for<with_fallback<Response, Fallback>> {
+   using type = fallback_parser<Response, Fallback>;
+};
+
+template <class Response>
+using parser_for_t = typename parser_for<Response>::type;
+
 template <
   class AsyncReadStream,
   class Storage,
@@ -55,13 +144,27 @@ class parse_op {
 private:
    AsyncReadStream& stream_;
    Storage* buf_ = nullptr;
-   parser<Response> parser_;
+   Response* res_ = nullptr;
+   parser_for_t<Response> parser_;
+   std::size_t size_ = 0;
+   std::size_t requested_ = 0;
    int start_ = 1;
 
+   // Returns true when the reply has been parsed or on error.
+   bool parse()
+   {
+      pin(*buf_, *res_);
+      auto&& db = make_dynamic_buffer(*buf_);
+      auto const b = db.data(0, db.size());
+      db.consume(parser_.parse(static_cast<char const*>(b.data()), b.size()));
+      return parser_.done() || parser_.ec();
+   }
+
 public:
    parse_op(AsyncReadStream& stream, Storage* buf, Response* res)
    : stream_ {stream}
    , buf_ {buf}
+   , res_ {res}
    , parser_ {res}
    { }
 
@@ -71,52 +174,51 @@ public:
                   , std::size_t n = 0)
    {
       switch (start_) {
-         for (;;) {
-            if (parser_.bulk() == bulk_type::none) {
-               case 1:
-               start_ = 0;
-               net::async_read_until(
-                  stream_,
-                  net::dynamic_buffer(*buf_),
-                  "\r\n",
-                  std::move(self));
-
-               return;
-            }
-
-	    // On a bulk read we can't read until delimiter since the
-	    // payload may contain the delimiter itself so we have to
-	    // read the whole chunk. However if the bulk blob is small
-	    // enough it may be already on the buffer buf_ we read
-	    // last time. If it is, there is no need of initiating
-	    // another async op otherwise we have to read the
-	    // missing bytes.
-            if (std::ssize(*buf_) < (parser_.bulk_length() + 2)) {
-               start_ = 0;
-	       auto const s = std::ssize(*buf_);
-	       auto const l = parser_.bulk_length();
-	       auto const to_read = static_cast<std::size_t>(l + 2 - s);
-               buf_->resize(l + 2);
-               net::async_read(
-                  stream_,
-                  net::buffer(buf_->data() + s, to_read),
-                  net::transfer_all(),
-                  std::move(self));
-               return;
-            }
-
-            default:
-	    {
-	       if (ec)
-		  return self.complete(ec);
-
-	       n = parser_.advance(buf_->data(), n);
-	       buf_->erase(0, n);
-	       if (parser_.done())
-		  return self.complete({});
+	 case 1:
+	 {
+	    // The reply may be already in the buffer as a result of a
+	    // previous read, in which case we post to avoid completing
+	    // inside the initiating function.
+	    start_ = 0;
+	    if (parse()) {
+	       start_ = 2;
+	       return net::post(std::move(self));
 	    }
-         }
+	 } break;
+	 case 2: return self.complete(parser_.ec());
+	 case 3:
+	 {
+	    // A read into the memory of the response.
+	    start_ = 0;
+	    if (ec)
+	       return self.complete(ec);
+
+	    parser_.commit_bulk(n);
+	    if (parse())
+	       return self.complete(parser_.ec());
+	 } break;
+	 default:
+	 {
+	    make_dynamic_buffer(*buf_).shrink(requested_ - n);
+	    if (ec)
+	       return self.complete(ec);
+
+	    if (parse())
+	       return self.complete(parser_.ec());
+	 }
+      }
+
+      if (auto const target = parser_.bulk_target(); std::size(target) >= direct_read_size) {
+	 start_ = 3;
+	 stream_.async_read_some(net::buffer(target.data(), std::size(target)), std::move(self));
+	 return;
       }
+
+      auto&& db = make_dynamic_buffer(*buf_);
+      size_ = db.size();
+      requested_ = read_size(parser_, size_);
+      db.grow(requested_);
+      stream_.async_read_some(db.data(size_, requested_), std::move(self));
    }
 };
 
@@ -130,31 +232,39 @@ auto read(
    Response& res,
    boost::system::error_code& ec)
 {
-   parser<Response> p {&res};
-   std::size_t n = 0;
-   do {
-      if (p.bulk() == bulk_type::none) {
-	 n = net::read_until(stream, net::dynamic_buffer(buf), "\r\n", ec);
-	 if (ec || n < 3)
-	    return n;
-      } else {
-	 auto const s = std::ssize(buf);
-	 auto const l = p.bulk_length();
-	 if (s < (l + 2)) {
-	    buf.resize(l + 2);
-	    auto const to_read = static_cast<std::size_t>(l + 2 - s);
-	    n = net::read(stream, net::buffer(buf.data() + s, to_read));
-	    assert(n >= to_read);
-	    if (ec)
-	       return n;
-	 }
+   parser_for_t<Response> p {&res};
+   std::size_t consumed = 0;
+   for (;;) {
+      pin(buf, res);
+      auto&& db = make_dynamic_buffer(buf);
+      auto const b = db.data(0, db.size());
+      auto const n = p.parse(static_cast<char const*>(b.data()), b.size());
+      db.consume(n);
+      consumed += n;
+      if (p.ec()) {
+	 ec = p.ec();
+	 return consumed;
       }
 
-      n = p.advance(buf.data(), n);
-      buf.erase(0, n);
-   } while (!p.done());
+      if (p.done())
+	 return consumed;
 
-   return n;
+      if (auto const target = p.bulk_target(); std::size(target) >= direct_read_size) {
+	 auto const r = stream.read_some(net::buffer(target.data(), std::size(target)), ec);
+	 p.commit_bulk(r);
+	 if (ec)
+	    return consumed;
+	 continue;
+      }
+
+      auto const size = db.size();
+      auto const requested = read_size(p, size);
+      db.grow(requested);
+      auto const r = stream.read_some(db.data(size, requested), ec);
+      db.shrink(requested - r);
+      if (ec)
+	 return consumed;
+   }
 }
 
 template<
@@ -176,6 +286,18 @@ read(
    return n;
 }
 
+/* Reads a reply into the response. When the response is a tuple of
+ * responses, as many consecutive replies are read into them in a
+ * single operation, for example
+ *
+ *    std::tuple<
+ *       resp::response_simple_string<>,
+ *       resp::response_number<int>,
+ *       resp::response_array<std::string>> res;
+ *    co_await resp::async_read(socket, buffer, res);
+ *
+ * See check_responses.
+ */
 template <
    class AsyncReadStream,
    class Storage,
@@ -198,6 +320,27 @@ auto async_read(
         stream);
 }
 
+/* Checks that the tuple has one response per command in the request
+ * and that each of them supports a type the command may reply with.
+ * Flat responses accept any aggregate, so only their leaf types are
+ * effectively checked.
+ */
+template <class Event, class... Responses>
+bool check_responses(
+   request<Event> const& req,
+   std::tuple<Responses...> const&)
+{
+   if (std::size(req.events) != sizeof...(Responses))
+      return false;
+
+   std::size_t i = 0;
+   auto const supports = [&](type_set s) {
+      return (reply_types(req.events[i++].first) & s) != 0;
+   };
+
+   return (supports(response_types<Responses>()) && ...);
+}
+
 template <
   class AsyncReadStream,
   class Storage>
@@ -206,6 +349,7 @@ private:
    AsyncReadStream& stream_;
    Storage* buf_ = nullptr;
    type* t_;
+   bool start_ = true;
 
 public:
    type_op(AsyncReadStream& stream, Storage* buf, type* t)
@@ -219,16 +363,22 @@ public:
                   , boost::system::error_code ec = {}
                   , std::size_t n = 0)
    {
-      if (std::empty(*buf_)) {
-	 net::async_read_until(
-	    stream_,
-	    net::dynamic_buffer(*buf_),
-	    "\r\n",
-	    std::move(self));
-      } else {
-	 *t_ = to_type(buf_->front());
+      auto&& db = make_dynamic_buffer(*buf_);
+      if (!start_)
+	 db.shrink(read_chunk_size - n);
+
+      if (ec)
 	 return self.complete(ec);
+
+      start_ = false;
+      if (db.size() == 0) {
+	 db.grow(read_chunk_size);
+	 stream_.async_read_some(db.data(0, read_chunk_size), std::move(self));
+	 return;
       }
+
+      *t_ = to_type(*static_cast<char const*>(db.data(0, 1).data()));
+      return self.complete(ec);
    }
 };
 
@@ -253,51 +403,102 @@ auto async_read_type(
         stream);
 }
 
+/* Reads the replies to the requests in recv.reqs and passes them to
+ * recv.receive. Pushes go to the channel when one is given, else to
+ * recv.receive with command::none. The channel is closed when reading
+ * stops.
+ */
 template <
    class AsyncReadStream,
    class Receiver>
 net::awaitable<void>
 async_read_responses(
    AsyncReadStream& socket,
-   Receiver& recv)
+   Receiver& recv,
+   push_channel* pushes = nullptr)
 {
-   std::string buffer;
+   struct closer {
+      push_channel* p;
+      ~closer() { if (p) p->close(); }
+   } close_pushes {pushes};
+
+   read_buffer buffer;
    std::queue<response_id<typename Receiver::event_type>> trans;
    for (;;) {
       type t;
-      co_await async_read_type(socket, buffer, t);
+      co_await resp::async_read_type(socket, buffer, t);
+
+      if (t == type::push && pushes) {
+	 auto& res = recv.response_buffers.array;
+	 co_await resp::async_read(socket, buffer, res);
+	 if (!pushes->try_push(res.result))
+	    co_await pushes->async_push(res.result);
+	 res.result.clear();
+	 continue;
+      }
+
       auto& req = recv.reqs.front();
       auto cmd = command::none;
       if (t != type::push)
 	 cmd = req.events.front().first;
 
-      // The next two ifs are used to deal with transactions.
+      // Transactions: the acknowledgements of MULTI and of the queued
+      // commands are read in one pass, the reply to EXEC is then split
+      // into the replies of the queued commands.
       auto const is_multi = cmd == command::multi;
       auto const is_exec = cmd == command::exec;
       auto const trans_empty = std::empty(trans);
 
-      if (is_multi || (!trans_empty && !is_exec)) {
-	 auto const* res = cmd == command::multi ? "OK" : "QUEUED";
-	 co_await async_read(socket, buffer, recv.response_buffers.simple_string);
-	 assert(recv.response_buffers.simple_string.result == res);
-	 trans.push({req.events.front().first, type::invalid, req.events.front().second});
-	 req.events.pop();
+      if (t != type::push && (is_multi || (!trans_empty && !is_exec))) {
+	 // The commands up to EXEC, usually in the same request.
+	 std::size_t n = 0;
+	 while (n < std::size(req.events) && (n == 0 || req.events[n].first != command::exec))
+	    ++n;
+
+	 // The acknowledgements accumulate until EXEC, where the first
+	 // error is reported to the command it belongs to. A push in
+	 // between stops the read, the remaining ones are read after it.
+	 repeated<response_acks> res {&recv.response_buffers.acks, n, true};
+	 co_await resp::async_read(socket, buffer, res);
+
+	 for (n = res.read; n != 0; --n) {
+	    trans.push({req.events.front().first, type::invalid, req.events.front().second});
+	    req.events.pop();
+	 }
 	 continue;
       }
 
       if (cmd == command::exec) {
 	 assert(trans.front().cmd == command::multi);
-	 co_await async_read(socket, buffer, recv.response_buffers.general);
+	 auto& res = recv.response_buffers.transaction;
+	 co_await resp::async_read(socket, buffer, res);
 	 trans.pop(); // Removes multi.
-	 for (int i = 0; !std::empty(trans); ++i) {
-	    trans.front().t = recv.response_buffers.general.at(i).t;
-	    recv.receive(trans.front(), recv.response_buffers.general.at(i).value);
+
+	 // An aborted transaction is reported to each of its commands,
+	 // as null or as the error that aborted it, except to the command
+	 // that could not be queued, which receives its own error. The
+	 // acknowledgement of MULTI comes first.
+	 auto& acks = recv.response_buffers.acks;
+	 for (std::size_t i = 0; !std::empty(trans); ++i) {
+	    auto& id = trans.front();
+	    if (res.aborted() && acks.errors != 0 && acks.error_index == i + 1) {
+	       id.t = acks.error_type;
+	       recv.receive(id, std::vector<std::string> {acks.error});
+	    } else if (res.aborted()) {
+	       id.t = res.top;
+	       recv.receive(id, std::empty(res.error) ? std::vector<std::string> {} : std::vector<std::string> {res.error});
+	    } else {
+	       id.t = res.result.at(i).t;
+	       recv.receive(id, std::move(res.result[i].value));
+	    }
 	    trans.pop();
 	 }
-	 recv.response_buffers.general.clear();
-	 trans = {};
+
+	 res.clear();
+	 acks.clear();
 	 req.events.pop(); // exec
 	 if (std::empty(req.events)) {
+	    recv.pool.recycle(std::move(recv.reqs.front()));
 	    recv.reqs.pop();
 	    if (!std::empty(recv.reqs)) {
 	       co_await async_write(
@@ -308,7 +509,7 @@ async_read_responses(
 	 continue;
       }
 
-      co_await async_read(socket, buffer, recv.response_buffers.array);
+      co_await resp::async_read(socket, buffer, recv.response_buffers.array);
 
       recv.receive(
 	 {cmd, t, req.events.front().second},
@@ -320,6 +521,7 @@ async_read_responses(
 	 req.events.pop();
 
       if (std::empty(req.events)) {
+	 recv.pool.recycle(std::move(recv.reqs.front()));
 	 recv.reqs.pop();
 	 if (!std::empty(recv.reqs)) {
 	    co_await async_write(
@@ -335,7 +537,15 @@ class receiver_base {
 private:
 public:
    responses<Event> response_buffers;
+
+   // Requests whose responses were read are recycled into the pool,
+   // new ones should be taken from it.
+   request_pool<Event> pool;
+
+   // A deque since the request being written and read is referred to
+   // across suspension points, a ring would move it when growing.
    std::queue<request<Event>> reqs;
+
    bool add(request<Event> req)
    {
       auto const empty = std::empty(reqs);
@@ -0,0 +1,152 @@
+/* Copyright (c) 2019 - 2021 Marcelo Zimbres Silva (mzimbres at gmail dot com)
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#pragma once
+
+#include <memory>
+#include <limits>
+#include <cstring>
+#include <stdexcept>
+#include <algorithm>
+
+#include <boost/asio/buffer.hpp>
+
+namespace aedis { namespace resp {
+
+/* A contiguous read buffer with read and write cursors.
+ *
+ * Consuming bytes only advances the read cursor, the unread bytes are
+ * moved to the front of the storage only when the free tail is
+ * exhausted. It implements the DynamicBuffer_v2 requirements and can
+ * be used as the Storage in async_read and read instead of a
+ * std::string, for example
+ *
+ *    resp::read_buffer buffer;
+ *    co_await resp::async_read(socket, buffer, res);
+ *
+ * The storage is reference counted so that responses holding views
+ * into it can retain it with segment(). While retained, bytes already
+ * written are never overwritten, new data goes to a fresh block
+ * instead.
+ */
+class read_buffer {
+public:
+   using const_buffers_type = boost::asio::const_buffer;
+   using mutable_buffers_type = boost::asio::mutable_buffer;
+
+private:
+   std::shared_ptr<char[]> data_;
+   std::size_t capacity_ = 0;
+   std::size_t rd_ = 0;
+   std::size_t wr_ = 0;
+   std::size_t max_size_;
+
+   void make_room(std::size_t n)
+   {
+      auto const s = size();
+
+      // Compacting is cheap when the readable bytes are no more than
+      // what has already been consumed. A retained block is left as
+      // it is and replaced by one of the same size. The storage is
+      // null before the first grow, so empty copies are skipped.
+      if (!pinned() && s + n <= capacity_ && s <= rd_) {
+	 if (s != 0)
+	    std::memmove(data_.get(), data_.get() + rd_, s);
+      } else {
+	 auto const cap = std::max(pinned() ? capacity_ : 2 * capacity_, s + n);
+	 std::shared_ptr<char[]> tmp {new char[cap]};
+	 if (s != 0)
+	    std::memcpy(tmp.get(), data_.get() + rd_, s);
+	 data_ = std::move(tmp);
+	 capacity_ = cap;
+      }
+
+      rd_ = 0;
+      wr_ = s;
+   }
+
+public:
+   explicit read_buffer(
+      std::size_t capacity = 0,
+      std::size_t max_size = std::numeric_limits<std::size_t>::max())
+   : data_ {capacity == 0 ? nullptr : new char[capacity]}
+   , capacity_ {capacity}
+   , max_size_ {max_size}
+   { }
+
+   // Copies would share the storage and write into the same tail.
+   read_buffer(read_buffer const&) = delete;
+   read_buffer& operator=(read_buffer const&) = delete;
+   read_buffer(read_buffer&&) = default;
+   read_buffer& operator=(read_buffer&&) = default;
+
+   std::size_t size() const noexcept
+      { return wr_ - rd_; }
+
+   std::size_t max_size() const noexcept
+      { return max_size_; }
+
+   std::size_t capacity() const noexcept
+      { return capacity_ - rd_; }
+
+   bool empty() const noexcept
+      { return rd_ == wr_; }
+
+   // True when the storage is retained by a segment.
+   bool pinned() const noexcept
+      { return data_.use_count() > 1; }
+
+   // Retains the current storage, views into data() stay valid for
+   // as long as the segment is alive.
+   std::shared_ptr<char const[]> segment() const noexcept
+      { return data_; }
+
+   const_buffers_type data(std::size_t pos, std::size_t n) const noexcept
+   {
+      pos = std::min(pos, size());
+      return {data_.get() + rd_ + pos, std::min(n, size() - pos)};
+   }
+
+   mutable_buffers_type data(std::size_t pos, std::size_t n) noexcept
+   {
+      pos = std::min(pos, size());
+      return {data_.get() + rd_ + pos, std::min(n, size() - pos)};
+   }
+
+   void grow(std::size_t n)
+   {
+      if (n > max_size_ - size())
+	 throw std::length_error("read_buffer: Too long.");
+
+      if (capacity_ - wr_ < n)
+	 make_room(n);
+
+      wr_ += n;
+   }
+
+   void shrink(std::size_t n) noexcept
+      { wr_ -= std::min(n, size()); }
+
+   void consume(std::size_t n) noexcept
+   {
+      rd_ += std::min(n, size());
+      if (rd_ == wr_ && !pinned())
+	 rd_ = wr_ = 0;
+   }
+
+   void clear() noexcept
+      { consume(size()); }
+};
+
+// Makes read_buffer usable where the read functions expect the
+// result of net::dynamic_buffer(storage).
+inline
+read_buffer& dynamic_buffer(read_buffer& buf) noexcept
+   { return buf; }
+
+} // resp
+} // aedis
@@ -7,9 +7,15 @@
 
 #pragma once
 
+#include <array>
 #include <queue>
+#include <memory>
 #include <vector>
 #include <string>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <charconv>
 #include <algorithm>
 #include <functional>
 #include <type_traits>
@@ -19,73 +25,187 @@
 #include <boost/beast/core/stream_traits.hpp>
 
 #include "command.hpp"
+#include "fields.hpp"
+#include "ring_queue.hpp"
 
 namespace aedis { namespace resp {
 
+// Number of decimal digits in n.
+constexpr std::size_t count_digits(std::uint64_t n) noexcept
+{
+   std::size_t d = 1;
+   for (; n >= 10; n /= 10)
+      ++d;
+   return d;
+}
+
+// Size of the encoding of an aggregate header and of a bulk string
+// with n bytes.
+constexpr std::size_t header_size(std::size_t n) noexcept
+   { return 1 + count_digits(n) + 2; }
+
+constexpr std::size_t bulk_size(std::size_t n) noexcept
+   { return header_size(n) + n + 2; }
+
 inline
-void make_bulk(std::string& to, std::string_view param)
+char* write_header(char* p, char c, std::size_t n) noexcept
 {
-   to += "$";
-   to += std::to_string(std::size(param));
-   to += "\r\n";
-   to += param;
-   to += "\r\n";
+   *p++ = c;
+   p = std::to_chars(p, p + 20, n).ptr;
+   *p++ = '\r';
+   *p++ = '\n';
+   return p;
 }
 
 inline
-void make_header(std::string& to, int size)
+char* write_bulk(char* p, std::string_view v) noexcept
 {
-   to += "*";
-   to += std::to_string(size);
-   to += "\r\n";
+   p = write_header(p, '$', std::size(v));
+   std::memcpy(p, std::data(v), std::size(v));
+   p += std::size(v);
+   *p++ = '\r';
+   *p++ = '\n';
+   return p;
 }
 
-struct accumulator {
-   auto
-   operator()(
-      std::string a,
-      std::string_view b) const
-   {
-      make_bulk(a, b);
-      return a;
+// Formats a number into buf, doubles in the shortest form that
+// round-trips and bools as 1 or 0.
+template <class T>
+requires std::is_arithmetic_v<T>
+std::string_view format_number(char (&buf)[32], T v) noexcept
+{
+   if constexpr (std::is_same_v<T, bool>) {
+      return v ? "1" : "0";
+   } else {
+      auto const r = std::to_chars(buf, buf + sizeof buf, v);
+      return {buf, static_cast<std::size_t>(r.ptr - buf)};
    }
+}
 
-   template <class T>
-   auto
-   operator()(
-      std::string a,
-      T b,
-      std::enable_if<(std::is_integral<T>::value || std::is_floating_point<T>::value),
-		      bool>::type = false) const
-   {
-      make_bulk(a, std::to_string(b));
-      return a;
-   }
+/* Command arguments are strings, numbers or pairs of them. arg_size
+ * returns the size of their encoding and write_arg writes it and
+ * returns its end. Floating point numbers are formatted only in
+ * write_arg, arg_size returns an upper bound for them, so callers trim
+ * what was not written with trim_to.
+ */
+inline
+std::size_t arg_size(std::string_view v) noexcept
+   { return bulk_size(std::size(v)); }
 
-   auto
-   operator()(
-      std::string a,
-      std::pair<std::string, std::string_view> b) const
-   {
-      make_bulk(a, b.first);
-      make_bulk(a, b.second);
-      return a;
+template <class T>
+requires std::is_arithmetic_v<T>
+std::size_t arg_size(T v) noexcept
+{
+   if constexpr (std::is_floating_point_v<T>) {
+      return bulk_size(32);
+   } else if constexpr (std::is_signed_v<T>) {
+      auto const m = static_cast<std::uint64_t>(v);
+      return v < 0 ? bulk_size(1 + count_digits(0 - m)) : bulk_size(count_digits(m));
+   } else {
+      return bulk_size(count_digits(v));
    }
+}
 
-   template <class T>
-   auto
-   operator()(
-      std::string a,
-      std::pair<T, std::string_view> b,
-      std::enable_if<(std::is_integral<T>::value || std::is_floating_point<T>::value),
-		      bool>::type = false) const
-   {
-      make_bulk(a, std::to_string(b.first));
-      make_bulk(a, b.second);
-      return a;
-   }
+template <class T, class U>
+std::size_t arg_size(std::pair<T, U> const& v) noexcept
+   { return arg_size(v.first) + arg_size(v.second); }
+
+inline
+char* write_arg(char* p, std::string_view v) noexcept
+   { return write_bulk(p, v); }
+
+template <class T>
+requires std::is_arithmetic_v<T>
+char* write_arg(char* p, T v) noexcept
+{
+   char buf[32];
+   return write_bulk(p, format_number(buf, v));
+}
+
+template <class T, class U>
+char* write_arg(char* p, std::pair<T, U> const& v) noexcept
+   { return write_arg(write_arg(p, v.first), v.second); }
+
+// Appends n uninitialized bytes to s and returns a pointer to them.
+inline
+char* append_uninitialized(std::string& s, std::size_t n)
+{
+   auto const size = std::size(s);
+   s.resize(size + n);
+   return s.data() + size;
+}
+
+// Drops the bytes from p to the end of s, that were appended with
+// append_uninitialized but not written.
+inline
+void trim_to(std::string& s, char const* p) noexcept
+{
+   assert(p >= std::data(s) && p <= std::data(s) + std::size(s));
+   s.resize(static_cast<std::size_t>(p - std::data(s)));
+}
+
+inline
+void make_bulk(std::string& to, std::string_view param)
+   { write_bulk(append_uninitialized(to, bulk_size(std::size(param))), param); }
+
+inline
+void make_bulk_value(std::string& to, std::string_view v)
+   { make_bulk(to, v); }
+
+template <class T>
+requires std::is_arithmetic_v<T>
+void make_bulk_value(std::string& to, T v)
+{
+   char buf[32];
+   make_bulk(to, format_number(buf, v));
+}
+
+inline
+void make_header(std::string& to, int size)
+   { write_header(append_uninitialized(to, header_size(size)), '*', size); }
+
+// A string literal usable as a template argument.
+template <std::size_t N>
+struct fixed_string {
+   char data[N] {};
+
+   constexpr fixed_string(char const (&s)[N]) noexcept
+      { std::copy_n(s, N, data); }
+
+   static constexpr std::size_t size = N - 1;
 };
 
+template <fixed_string Name>
+constexpr auto encode_command() noexcept
+{
+   constexpr auto n = Name.size;
+   std::array<char, header_size(1) + bulk_size(n)> ret {};
+
+   auto* p = ret.data();
+   auto put = [&](std::string_view s) { for (auto c : s) *p++ = c; };
+
+   put("*1\r\n$");
+   char digits[20];
+   auto d = count_digits(n);
+   for (auto m = n; d != 0; m /= 10)
+      digits[--d] = '0' + m % 10;
+   put({digits, count_digits(n)});
+   put("\r\n");
+   put({Name.data, n});
+   put("\r\n");
+
+   return ret;
+}
+
+template <fixed_string Name>
+inline constexpr auto command_encoding = encode_command<Name>();
+
+// The encoding of a command without arguments, computed at compile
+// time, for example encoded<"PING">().
+template <fixed_string Name>
+constexpr std::string_view encoded() noexcept
+   { return {command_encoding<Name>.data(), std::size(command_encoding<Name>)}; }
+
 inline
 void assemble(std::string& ret, std::string_view cmd)
 {
@@ -93,6 +213,9 @@ void assemble(std::string& ret, std::string_view cmd)
    make_bulk(ret, cmd);
 }
 
+// Appends the command with its keys and the arguments in [begin,
+// end), each of them counting as size elements. The encoded size is
+// computed first so that the payload grows at most once.
 template <class Iter>
 auto assemble( std::string& ret
              , std::string_view cmd
@@ -101,29 +224,24 @@ auto assemble( std::string& ret
              , Iter end
              , int size = 1)
 {
-   auto const d1 =
-      std::distance( std::cbegin(key)
-                   , std::cend(key));
-
-   auto const d2 = std::distance(begin, end);
-
-   // Perhaps, we would avoid some copying by passing ret to the
-   // functions below instead of declaring a below.
-   std::string a;
-   make_header(a, 1 + d1 + size * d2);
-   make_bulk(a, cmd);
-
-   auto b =
-      std::accumulate( std::cbegin(key)
-                     , std::cend(key)
-                     , std::move(a)
-                     , accumulator{});
-
-   ret +=
-      std::accumulate( begin
-                     , end
-                     , std::move(b)
-                     , accumulator{});
+   std::size_t const n =
+      1 + std::size(key) + size * std::distance(begin, end);
+
+   auto total = header_size(n) + arg_size(cmd);
+   for (auto k : key)
+      total += arg_size(k);
+   for (auto it = begin; it != end; ++it)
+      total += arg_size(*it);
+
+   auto* p = append_uninitialized(ret, total);
+   p = write_header(p, '*', n);
+   p = write_arg(p, cmd);
+   for (auto k : key)
+      p = write_arg(p, k);
+   for (; begin != end; ++begin)
+      p = write_arg(p, *begin);
+
+   trim_to(ret, p);
 }
 
 inline
@@ -133,45 +251,121 @@ void assemble(std::string& ret, std::string_view cmd, std::string_view key)
    assemble(ret, cmd, {key}, std::cbegin(dummy), std::cend(dummy));
 }
 
+/* A value that is written from its own memory instead of being copied
+ * into the payload, see borrow and share.
+ */
+struct value_ref {
+   std::string_view data;
+   std::shared_ptr<void const> owner;
+};
+
+// The caller keeps the bytes alive until the request has been written.
+inline
+value_ref borrow(std::string_view v) noexcept
+   { return {v, nullptr}; }
+
+// The request keeps the bytes alive.
+template <class T>
+value_ref share(std::shared_ptr<T const> v) noexcept
+{
+   std::string_view const data {*v};
+   return {data, std::move(v)};
+}
+
+template <class T>
+value_ref share(std::shared_ptr<T> v) noexcept
+   { return share(std::shared_ptr<T const>(std::move(v))); }
+
+// A value_ref placed at offset in the payload.
+struct segment {
+   std::size_t offset;
+   std::string_view data;
+};
+
 enum class event {ignore};
 
 // TODO: Make the write functions friend of this class and make the
 // payload private.
 template <class Event = event>
 class request {
+private:
+   std::vector<segment> segments_;
+   std::vector<std::shared_ptr<void const>> owners_;
+
+   // Values shorter than this are cheaper to copy than to send as an
+   // extra buffer.
+   static constexpr std::size_t copy_threshold = 4096;
+
+   void add_bulk(value_ref v)
+   {
+      if (std::size(v.data) < copy_threshold) {
+	 make_bulk(payload, v.data);
+	 return;
+      }
+
+      auto const n = std::size(v.data);
+      write_header(append_uninitialized(payload, header_size(n)), '$', n);
+      segments_.push_back({std::size(payload), v.data});
+      payload += "\r\n";
+      if (v.owner)
+	 owners_.push_back(std::move(v.owner));
+   }
+
 public:
    std::string payload;
-   std::queue<std::pair<command, Event>> events;
+   ring_queue<std::pair<command, Event>> events;
 
 public:
    bool empty() const noexcept { return std::empty(payload); };
+
+   // Keeps the capacity of the payload and of the events.
    void clear()
    {
       payload.clear();
-      events = {};
+      events.clear();
+      segments_.clear();
+      owners_.clear();
+   }
+
+   /* Values that are not part of the payload, in the order of their
+    * offsets. The data to write is the payload with each of them
+    * inserted at its offset.
+    */
+   auto const& segments() const noexcept { return segments_; }
+
+   // Appends the commands of other to this request.
+   void append_request(request const& other)
+   {
+      auto const offset = std::size(payload);
+      payload += other.payload;
+      for (auto const& s : other.segments_)
+	 segments_.push_back({offset + s.offset, s.data});
+      owners_.insert(std::end(owners_), std::cbegin(other.owners_), std::cend(other.owners_));
+      for (std::size_t i = 0; i < std::size(other.events); ++i)
+	 events.push(other.events[i]);
    }
 
    void ping(Event e = Event::ignore)
    {
-      resp::assemble(payload, "PING");
+      payload += resp::encoded<"PING">();
       events.push({command::ping, e});
    }
 
    void quit(Event e = Event::ignore)
    {
-      resp::assemble(payload, "QUIT");
+      payload += resp::encoded<"QUIT">();
       events.push({command::quit, e});
    }
 
    void multi(Event e = Event::ignore)
    {
-      resp::assemble(payload, "MULTI");
+      payload += resp::encoded<"MULTI">();
       events.push({command::multi, e});
    }
 
    void exec(Event e = Event::ignore)
    {
-      resp::assemble(payload, "EXEC");
+      payload += resp::encoded<"EXEC">();
       events.push({command::exec, e});
    }
 
@@ -192,25 +386,25 @@ public:
 
    auto bgrewriteaof(Event e = Event::ignore)
    {
-      resp::assemble(payload, "BGREWRITEAOF");
+      payload += resp::encoded<"BGREWRITEAOF">();
       events.push({command::bgrewriteaof, e});
    }
 
    auto role(Event e = Event::ignore)
    {
-      resp::assemble(payload, "ROLE");
+      payload += resp::encoded<"ROLE">();
       events.push({command::role, e});
    }
 
    auto bgsave(Event e = Event::ignore)
    {
-      resp::assemble(payload, "BGSAVE");
+      payload += resp::encoded<"BGSAVE">();
       events.push({command::bgsave, e});
    }
 
    auto flushall(Event e = Event::ignore)
    {
-      resp::assemble(payload, "FLUSHALL");
+      payload += resp::encoded<"FLUSHALL">();
       events.push({command::flushall, e});
    }
 
@@ -298,7 +492,7 @@ public:
       int end = -1,
       Event e = Event::ignore)
    {
-      auto par = {std::to_string(start), std::to_string(end)};
+      auto par = {start, end};
       resp::assemble( payload
    	            , "BITCOUNT"
    		    , {key}
@@ -382,6 +576,48 @@ public:
       events.push({command::set, e});
    }
 
+   // The overloads taking a value_ref write the value from its own
+   // memory, see borrow and share.
+   auto
+   set(std::string_view key,
+       value_ref value,
+       Event e = Event::ignore)
+   {
+      make_header(payload, 3);
+      make_bulk(payload, "SET");
+      make_bulk(payload, key);
+      add_bulk(std::move(value));
+      events.push({command::set, e});
+   }
+
+   auto
+   publish(
+      std::string_view key,
+      value_ref msg,
+      Event e = Event::ignore)
+   {
+      make_header(payload, 3);
+      make_bulk(payload, "PUBLISH");
+      make_bulk(payload, key);
+      add_bulk(std::move(msg));
+      events.push({command::publish, e});
+   }
+
+   auto
+   hset(
+      std::string_view key,
+      std::string_view field,
+      value_ref value,
+      Event e = Event::ignore)
+   {
+      make_header(payload, 4);
+      make_bulk(payload, "HSET");
+      make_bulk(payload, key);
+      make_bulk(payload, field);
+      add_bulk(std::move(value));
+      events.push({command::hset, e});
+   }
+
    // TODO: Find a way to assert the value type is a pair.
    template <class Range>
    auto
@@ -394,6 +630,30 @@ public:
       resp::assemble(payload, "HSET", {key}, std::cbegin(r), std::cend(r), 2);
       events.push({command::hset, e});
    }
+
+   // Stores the fields of obj, see struct_fields.
+   template <has_fields T>
+   auto
+   hset(
+      std::string_view key,
+      T const& obj, Event e = Event::ignore)
+   {
+      std::size_t const n = 2 + 2 * field_count<T>;
+      auto total = header_size(n) + arg_size("HSET") + arg_size(key);
+      for_each_field(obj, [&](auto name, auto const& value) {
+	 total += arg_size(name) + arg_size(value);
+      });
+
+      auto* p = append_uninitialized(payload, total);
+      p = write_header(p, '*', n);
+      p = write_arg(p, "HSET");
+      p = write_arg(p, key);
+      for_each_field(obj, [&](auto name, auto const& value) {
+	 p = write_arg(write_arg(p, name), value);
+      });
+      trim_to(payload, p);
+      events.push({command::hset, e});
+   }
    
    auto
    hincrby(
@@ -402,8 +662,8 @@ public:
       int by,
       Event e = Event::ignore)
    {
-      auto par = {field, std::to_string(by)};
-      resp::assemble(payload, "HINCRBY", {key}, std::cbegin(par), std::cend(par));
+      std::pair<std::string_view, int> par[] = {{field, by}};
+      resp::assemble(payload, "HINCRBY", {key}, std::cbegin(par), std::cend(par), 2);
       events.push({command::hincrby, e});
    }
    
@@ -469,6 +729,22 @@ public:
 
       events.push({command::hmget, e});
    }
+
+   template <class Range>
+   auto
+   hmget(
+      std::string_view key,
+      Range const& fields,
+      Event e = Event::ignore)
+   {
+      resp::assemble( payload
+   	            , "HMGET"
+   		    , {key}
+   		    , std::cbegin(fields)
+   		    , std::cend(fields));
+
+      events.push({command::hmget, e});
+   }
    
    auto
    expire(
@@ -476,7 +752,7 @@ public:
       int secs,
       Event e = Event::ignore)
    {
-      auto par = {std::to_string(secs)};
+      auto par = {secs};
       resp::assemble(payload, "EXPIRE", {key}, std::cbegin(par), std::cend(par));
       events.push({command::expire, e});
    }
@@ -488,9 +764,8 @@ public:
       std::string_view value,
       Event e = Event::ignore)
    {
-      std::initializer_list<std::string_view> par =
-	 {std::to_string(score), value};
-      resp::assemble(payload, "ZADD", {key}, std::cbegin(par), std::cend(par));
+      std::pair<int, std::string_view> par[] = {{score, value}};
+      resp::assemble(payload, "ZADD", {key}, std::cbegin(par), std::cend(par), 2);
       events.push({command::zadd, e});
    }
    
@@ -510,7 +785,7 @@ public:
 	  int max = -1,
 	  Event e = Event::ignore)
    {
-      auto par = {std::to_string(min), std::to_string(max)};
+      auto par = {min, max};
       resp::assemble(payload, "ZRANGE", {key}, std::cbegin(par), std::cend(par));
       events.push({command::zrange, e});
    }
@@ -522,12 +797,13 @@ public:
       int max,
       Event e = Event::ignore)
    {
-      auto max_str = std::string {"inf"};
+      char buf[32];
+      std::string_view max_str = "inf";
       if (max != -1)
-         max_str = std::to_string(max);
+         max_str = resp::format_number(buf, max);
    
-      auto par = {std::to_string(min) , max_str};
-      resp::assemble(payload, "ZRANGEBYSCORE", {key}, std::cbegin(par), std::cend(par));
+      std::pair<int, std::string_view> par[] = {{min, max_str}};
+      resp::assemble(payload, "ZRANGEBYSCORE", {key}, std::cbegin(par), std::cend(par), 2);
       events.push({command::zrangebyscore, e});
    }
    
@@ -537,8 +813,7 @@ public:
       int score,
       Event e = Event::ignore)
    {
-      auto const s = std::to_string(score);
-      auto par = {s, s};
+      auto par = {score, score};
       resp::assemble(payload, "ZREMRANGEBYSCORE", {key}, std::cbegin(par), std::cend(par));
       events.push({command::zremrangebyscore, e});
    }
@@ -550,7 +825,7 @@ public:
       int max = -1,
       Event e = Event::ignore)
    {
-      auto par = {std::to_string(min), std::to_string(max)};
+      auto par = {min, max};
       resp::assemble(payload, "LRANGE", {key}, std::cbegin(par), std::cend(par));
       events.push({command::lrange, e});
    }
@@ -562,7 +837,7 @@ public:
       int max = -1,
       Event e = Event::ignore)
    {
-      auto par = {std::to_string(min), std::to_string(max)};
+      auto par = {min, max};
       resp::assemble(payload, "LTRIM", {key}, std::cbegin(par), std::cend(par));
       events.push({command::ltrim, e});
    }
@@ -647,5 +922,45 @@ public:
    }
 };
 
+/* Requests returned to the pool are cleared and handed out again with
+ * their capacity intact, so that a steady stream of requests of
+ * similar size does not allocate. At most max_size requests are kept,
+ * further ones are released, so that recycling requests that were not
+ * taken from the pool does not grow it without bounds.
+ */
+template <class Event = event>
+class request_pool {
+private:
+   std::vector<request<Event>> free_;
+   std::size_t max_size_;
+
+public:
+   explicit request_pool(std::size_t max_size = 16)
+   : max_size_ {max_size}
+   { }
+
+   request<Event> get()
+   {
+      if (std::empty(free_))
+	 return {};
+
+      auto req = std::move(free_.back());
+      free_.pop_back();
+      return req;
+   }
+
+   void recycle(request<Event> req)
+   {
+      if (std::size(free_) == max_size_)
+	 return;
+
+      req.clear();
+      free_.push_back(std::move(req));
+   }
+
+   auto size() const noexcept { return std::size(free_); }
+   auto max_size() const noexcept { return max_size_; }
+};
+
 } // resp
 } // aedis
@@ -11,6 +11,7 @@
 #include <list>
 #include <array>
 #include <vector>
+#include <unordered_set>
 #include <string>
 #include <ostream>
 #include <numeric>
@@ -18,8 +19,12 @@
 #include <string_view>
 #include <charconv>
 #include <iomanip>
+#include <algorithm>
+#include <utility>
 
 #include "type.hpp"
+#include "number.hpp"
+#include "fields.hpp"
 #include "command.hpp"
 
 namespace aedis { namespace resp {
@@ -28,7 +33,7 @@ template <class T>
 std::enable_if<std::is_integral<T>::value, void>::type
 from_string_view(std::string_view s, T& n)
 {
-   auto r = std::from_chars(s.data(), s.data() + s.size(), n);
+   auto r = parse_integer(s.data(), s.data() + s.size(), n);
    if (r.ec == std::errc::invalid_argument)
       throw std::runtime_error("from_chars: Unable to convert");
 }
@@ -37,6 +42,22 @@ inline
 void from_string_view(std::string_view s, std::string& r)
    { r = s; }
 
+// Makes room for n more elements in a vector or unordered container.
+// Growth stays geometric when nested aggregates announce their sizes
+// one at a time.
+template <class Container>
+void reserve_more(Container& c, std::size_t n)
+{
+   auto const size = std::size(c) + n;
+   if constexpr (requires { c.capacity(); }) {
+      if (size > c.capacity())
+	 c.reserve(std::max(size, 2 * c.capacity()));
+   } else {
+      if (size > c.bucket_count() * c.max_load_factor())
+	 c.reserve(std::max(size, 2 * std::size(c)));
+   }
+}
+
 // The interface required from from the parser.
 struct response_ignore {
    void pop() {}
@@ -60,8 +81,15 @@ struct response_ignore {
    ~response_ignore() {}
 };
 
-// This response type is able to deal with recursive redis responses
-// as in a transaction for example.
+/* This response type is able to deal with recursive redis responses
+ * as in a transaction for example.
+ *
+ * Elements are stored in a tape in the order they are received, the
+ * contents of all leaves in a single string and the type, depth,
+ * offset and length of each element in parallel arrays. For
+ * aggregates the length is their number of elements. Clearing keeps
+ * the capacity so that decoding further replies does not allocate.
+ */
 class response_general {
 public:
    struct elem {
@@ -73,40 +101,104 @@ public:
 
 private:
    int depth_ = 0;
-   std::vector<elem> resps_;
+   std::string data_;
+   std::vector<type> types_;
+   std::vector<int> depths_;
+   std::vector<std::size_t> offsets_;
+   std::vector<std::size_t> lengths_;
+
+   // Tape positions of the elements returned by at.
+   std::vector<std::size_t> elems_;
+
+   void add_entry(type t, std::size_t offset, std::size_t length)
+   {
+      types_.push_back(t);
+      depths_.push_back(depth_);
+      offsets_.push_back(offset);
+      lengths_.push_back(length);
+   }
 
    void add_aggregate(int n, type t)
    {
-      if (depth_ == 0) {
-	 resps_.reserve(n);
-	 ++depth_;
-	 return;
-      }
-      
-      resps_.emplace_back(depth_, t, n);
-      resps_.back().value.reserve(n);
+      if (depth_ == 0)
+	 reserve_more(elems_, n);
+
+      reserve_more(types_, n + 1);
+      reserve_more(depths_, n + 1);
+      reserve_more(offsets_, n + 1);
+      reserve_more(lengths_, n + 1);
+
+      if (depth_ == 1)
+	 elems_.push_back(std::size(types_));
+
+      add_entry(t, std::size(data_), n);
       ++depth_;
    }
 
    void add(std::string_view s, type t)
    {
-      assert(!std::empty(resps_));
-      if (std::ssize(resps_.back().value) == resps_.back().expected_size) {
-	 resps_.emplace_back(depth_, t, 1, std::vector<std::string>{std::string{s}});
-      } else {
-	 resps_.back().value.push_back(std::string{s});
-      }
+      if (depth_ <= 1)
+	 elems_.push_back(std::size(types_));
+
+      add_entry(t, std::size(data_), std::size(s));
+      data_.append(s);
    }
 
 public:
    void clear()
-      { resps_.clear(); depth_ = 0;}
+   {
+      depth_ = 0;
+      data_.clear();
+      types_.clear();
+      depths_.clear();
+      offsets_.clear();
+      lengths_.clear();
+      elems_.clear();
+   }
 
+   // Number of elements in the top-level aggregate, or one if the
+   // reply is not an aggregate.
    auto size() const
-      { return resps_.size(); }
+      { return std::size(elems_); }
+
+   // Copies the i-th element with the leaves it contains, provided
+   // for compatibility, prefer iterating over the tape.
+   elem at(std::size_t i) const
+   {
+      auto const k = elems_.at(i);
+      auto const end = i + 1 < std::size(elems_) ? elems_[i + 1] : std::size(types_);
+      auto const aggregate = contains(aggregate_types, types_[k]);
+
+      elem e {depths_[k], types_[k], aggregate ? static_cast<int>(lengths_[k]) : 1, {}};
+      e.value.reserve(aggregate ? lengths_[k] : 1);
+      for (auto j = k; j < end; ++j) {
+	 if (!contains(aggregate_types, types_[j]))
+	    e.value.emplace_back(value_at(j));
+      }
+
+      return e;
+   }
+
+   // Number of entries in the tape, aggregates included.
+   auto tape_size() const noexcept
+      { return std::size(types_); }
 
-   auto& at(int i) { return resps_.at(i); }
-   auto const& at(int i) const { return resps_.at(i); }
+   auto type_at(std::size_t j) const noexcept
+      { return types_[j]; }
+
+   auto depth_at(std::size_t j) const noexcept
+      { return depths_[j]; }
+
+   // The number of elements of an aggregate or the size of a leaf.
+   auto length_at(std::size_t j) const noexcept
+      { return lengths_[j]; }
+
+   std::string_view value_at(std::size_t j) const noexcept
+   {
+      if (contains(aggregate_types, types_[j]))
+	 return {};
+      return {data_.data() + offsets_[j], lengths_[j]};
+   }
 
    void pop() { --depth_; }
 
@@ -129,72 +221,143 @@ public:
    void on_streamed_string_part(std::string_view s = {}) {add(s, type::streamed_string_part);}
 };
 
-// A base class for flat responses which means response with no
-// embedded types in themselves. For exaple, a transaction with an
-// lrange in it will produce a response that is an array with an
-// array. That is not suitable for this class.
+/* Splits the reply to EXEC into the replies of the queued commands,
+ * the leaves of each of them flattened like in response_array. When
+ * the transaction was aborted the reply is null or an error instead
+ * of an array, see aborted.
+ */
+class response_transaction {
+public:
+   struct reply {
+      type t;
+      std::vector<std::string> value;
+   };
+
+private:
+   int depth_ = 0;
+
+   void add_aggregate(int n, type t)
+   {
+      if (depth_ == 0)
+	 reserve_more(result, n);
+      else if (depth_ == 1)
+	 result.push_back({t, {}});
+
+      if (depth_ >= 1)
+	 reserve_more(result.back().value, n);
+
+      ++depth_;
+   }
+
+   void add(std::string_view s, type t)
+   {
+      switch (depth_) {
+	 case 0: top = t; error = s; break;
+	 case 1: result.push_back({t, {std::string {s}}}); break;
+	 default: result.back().value.emplace_back(s);
+      }
+   }
+
+public:
+   std::vector<reply> result;
+
+   // The type of the reply when it is not an array and the error
+   // message if it is an error.
+   type top = type::array;
+   std::string error;
+
+   bool aborted() const noexcept
+      { return top != type::array; }
+
+   void clear()
+   {
+      depth_ = 0;
+      result.clear();
+      top = type::array;
+      error.clear();
+   }
+
+   void pop() { --depth_; }
+
+   void select_array(int n) {add_aggregate(n, type::array);}
+   void select_push(int n) {add_aggregate(n, type::push);}
+   void select_set(int n) {add_aggregate(n, type::set);}
+   void select_map(int n) {add_aggregate(n, type::map);}
+   void select_attribute(int n) {add_aggregate(n, type::attribute);}
+
+   void on_simple_string(std::string_view s) { add(s, type::simple_string); }
+   void on_simple_error(std::string_view s) { add(s, type::simple_error); }
+   void on_number(std::string_view s) {add(s, type::number);}
+   void on_double(std::string_view s) {add(s, type::double_type);}
+   void on_bool(std::string_view s) {add(s, type::boolean);}
+   void on_big_number(std::string_view s) {add(s, type::big_number);}
+   void on_null() {add({}, type::null);}
+   void on_blob_error(std::string_view s = {}) {add(s, type::blob_error);}
+   void on_verbatim_string(std::string_view s = {}) {add(s, type::verbatim_string);}
+   void on_blob_string(std::string_view s = {}) {add(s, type::blob_string);}
+   void on_streamed_string_part(std::string_view s = {}) {add(s, type::streamed_string_part);}
+};
+
+/* A base class for flat responses which means response with no
+ * embedded types in themselves. For exaple, a transaction with an
+ * lrange in it will produce a response that is an array with an
+ * array. That is not suitable for this class.
+ *
+ * Derived classes implement the on_*_impl functions of the types in
+ * their supported_types, which are called without virtual dispatch.
+ * The parser does not call the others, so they don't have to exist.
+ */
+template <class Derived>
 class response_base {
+private:
+   Derived& derived() noexcept
+      { return static_cast<Derived&>(*this); }
+
 protected:
-   virtual void on_simple_string_impl(std::string_view s)
-      { throw std::runtime_error("on_simple_string_impl: Has not been overridden."); }
-   virtual void on_simple_error_impl(std::string_view s)
-      { throw std::runtime_error("on_simple_error_impl: Has not been overridden."); }
-   virtual void on_number_impl(std::string_view s)
-      { throw std::runtime_error("on_number_impl: Has not been overridden."); }
-   virtual void on_double_impl(std::string_view s)
-      { throw std::runtime_error("on_double_impl: Has not been overridden."); }
-   virtual void on_null_impl()
-      { throw std::runtime_error("on_null_impl: Has not been overridden."); }
-   virtual void on_bool_impl(std::string_view s)
-      { throw std::runtime_error("on_bool_impl: Has not been overridden."); }
-   virtual void on_big_number_impl(std::string_view s)
-      { throw std::runtime_error("on_big_number_impl: Has not been overridden."); }
-   virtual void on_verbatim_string_impl(std::string_view s = {})
-      { throw std::runtime_error("on_verbatim_string_impl: Has not been overridden."); }
-   virtual void on_blob_string_impl(std::string_view s = {})
-      { throw std::runtime_error("on_blob_string_impl: Has not been overridden."); }
-   virtual void on_blob_error_impl(std::string_view s = {})
-      { throw std::runtime_error("on_blob_error_impl: Has not been overridden."); }
-   virtual void on_streamed_string_part_impl(std::string_view s = {})
-      { throw std::runtime_error("on_streamed_string_part: Has not been overridden."); }
-   virtual void select_array_impl(int n)
-      { throw std::runtime_error("select_array_impl: Has not been overridden."); }
-   virtual void select_set_impl(int n)
-      { throw std::runtime_error("select_set_impl: Has not been overridden."); }
-   virtual void select_map_impl(int n)
-      { throw std::runtime_error("select_map_impl: Has not been overridden."); }
-   virtual void select_push_impl(int n)
-      { throw std::runtime_error("select_push_impl: Has not been overridden."); }
+   // Aggregates are flattened, n is the number of elements that
+   // follow and can be used to preallocate.
+   void select_array_impl(int n) { }
+   void select_set_impl(int n) { }
+   void select_map_impl(int n) { }
+   void select_push_impl(int n) { }
 
 public:
    void pop() {}
    void select_attribute(int n) { }
-   void select_push(int n) { }
-   void select_array(int n) { }
-   void select_set(int n) { }
-   void select_map(int n) { }
-   void on_simple_error(std::string_view s) { on_simple_error_impl(s); }
-   void on_blob_error(std::string_view s = {}) { on_blob_error_impl(s); }
-   void on_null() { on_null_impl(); }
-   void on_simple_string(std::string_view s) { on_simple_string_impl(s); }
-   void on_number(std::string_view s) { on_number_impl(s); }
-   void on_double(std::string_view s) { on_double_impl(s); }
-   void on_bool(std::string_view s) { on_bool_impl(s); }
-   void on_big_number(std::string_view s) { on_big_number_impl(s); }
-   void on_verbatim_string(std::string_view s = {}) { on_verbatim_string_impl(s); }
-   void on_blob_string(std::string_view s = {}) { on_blob_string_impl(s); }
-   void on_streamed_string_part(std::string_view s = {}) { on_streamed_string_part_impl(s); }
-   virtual ~response_base() {}
+   void select_push(int n) { derived().select_push_impl(n); }
+   void select_array(int n) { derived().select_array_impl(n); }
+   void select_set(int n) { derived().select_set_impl(n); }
+   void select_map(int n) { derived().select_map_impl(n); }
+   void on_simple_error(std::string_view s) { derived().on_simple_error_impl(s); }
+   void on_blob_error(std::string_view s = {}) { derived().on_blob_error_impl(s); }
+   void on_null() { derived().on_null_impl(); }
+   void on_simple_string(std::string_view s) { derived().on_simple_string_impl(s); }
+   void on_number(std::string_view s) { derived().on_number_impl(s); }
+   void on_double(std::string_view s) { derived().on_double_impl(s); }
+   void on_bool(std::string_view s) { derived().on_bool_impl(s); }
+   void on_big_number(std::string_view s) { derived().on_big_number_impl(s); }
+   void on_verbatim_string(std::string_view s = {}) { derived().on_verbatim_string_impl(s); }
+   void on_blob_string(std::string_view s = {}) { derived().on_blob_string_impl(s); }
+   void on_streamed_string_part(std::string_view s = {}) { derived().on_streamed_string_part_impl(s); }
+
+   // The types the parser passes to this response, derived classes
+   // add the types they implement.
+   static constexpr type_set supported_types = aggregate_types;
 };
 
 template <class T>
-class response_number : public response_base {
+class response_number : public response_base<response_number<T>> {
    static_assert(std::is_integral<T>::value);
 private:
-   void on_number_impl(std::string_view s) override
+   friend response_base<response_number>;
+
+   void on_number_impl(std::string_view s)
       { from_string_view(s, result); }
 
 public:
+   static constexpr type_set supported_types =
+      aggregate_types | make_type_set(type::number);
+
    T result;
 };
 
@@ -202,20 +365,45 @@ template<
    class CharT = char,
    class Traits = std::char_traits<CharT>,
    class Allocator = std::allocator<CharT>>
-class response_blob_string : public response_base {
+class response_blob_string
+   : public response_base<response_blob_string<CharT, Traits, Allocator>> {
 private:
+   friend response_base<response_blob_string>;
+
    void add(std::string_view s)
       { from_string_view(s, result); }
 
-   void on_blob_string_impl(std::string_view s) override
-      { add(s); }
-   void on_blob_error_impl(std::string_view s) override
+   // Set by blob_string_buffer, the payload is then already in result.
+   bool filled_ = false;
+
+   void on_blob_string_impl(std::string_view s)
+   {
+      if (!std::exchange(filled_, false))
+	 add(s);
+   }
+
+   void on_blob_error_impl(std::string_view s)
       { add(s); }
-   void on_simple_string_impl(std::string_view s) override
+   void on_simple_string_impl(std::string_view s)
       { add(s); }
-   void on_simple_error_impl(std::string_view s) override
+   void on_simple_error_impl(std::string_view s)
       { add(s); }
 public:
+   static constexpr type_set supported_types =
+      aggregate_types | make_type_set(
+	 type::blob_string, type::blob_error,
+	 type::simple_string, type::simple_error);
+
+   // The payload is read straight into result, see
+   // provides_blob_buffers.
+   char* blob_string_buffer(std::size_t n)
+      requires std::is_same_v<CharT, char>
+   {
+      result.resize(n);
+      filled_ = true;
+      return result.data();
+   }
+
    std::basic_string<CharT, Traits, Allocator> result;
 };
 
@@ -224,17 +412,23 @@ template<
    class Traits = std::char_traits<CharT>,
    class Allocator = std::allocator<CharT>
    >
-class response_simple_string : public response_base {
+class response_simple_string
+   : public response_base<response_simple_string<CharT, Traits, Allocator>> {
 private:
+   friend response_base<response_simple_string>;
+
    void add(std::string_view s)
       { from_string_view(s, result); }
 
-   void on_simple_string_impl(std::string_view s) override
+   void on_simple_string_impl(std::string_view s)
       { add(s); }
-   void on_simple_error_impl(std::string_view s) override
+   void on_simple_error_impl(std::string_view s)
       { add(s); }
 
 public:
+   static constexpr type_set supported_types =
+      aggregate_types | make_type_set(type::simple_string, type::simple_error);
+
    std::basic_string<CharT, Traits, Allocator> result;
 };
 
@@ -244,12 +438,18 @@ template <
    class Traits = std::char_traits<CharT>,
    class Allocator = std::allocator<CharT>
    >
-class response_big_number : public response_base {
+class response_big_number
+   : public response_base<response_big_number<CharT, Traits, Allocator>> {
 private:
-   void on_big_number_impl(std::string_view s) override
+   friend response_base<response_big_number>;
+
+   void on_big_number_impl(std::string_view s)
       { from_string_view(s, result); }
 
 public:
+   static constexpr type_set supported_types =
+      aggregate_types | make_type_set(type::big_number);
+
    std::basic_string<CharT, Traits, Allocator> result;
 };
 
@@ -259,30 +459,41 @@ template <
    class Traits = std::char_traits<CharT>,
    class Allocator = std::allocator<CharT>
    >
-class response_double : public response_base {
+class response_double
+   : public response_base<response_double<CharT, Traits, Allocator>> {
 private:
-   void on_double_impl(std::string_view s) override
+   friend response_base<response_double>;
+
+   void on_double_impl(std::string_view s)
       { from_string_view(s, result); }
 
 public:
+   static constexpr type_set supported_types =
+      aggregate_types | make_type_set(type::double_type);
+
    std::basic_string<CharT, Traits, Allocator> result;
 };
 
 template <
    class T,
    class Allocator = std::allocator<T>>
-class response_list : public response_base {
+class response_list : public response_base<response_list<T, Allocator>> {
 private:
-   void on_blob_string_impl(std::string_view s) override
+   friend response_base<response_list>;
+
+   void on_blob_string_impl(std::string_view s)
    {
       T r;
       from_string_view(s, r);
       result.push_back(std::move(r));
    }
 
-   void select_array_impl(int n) override { }
+   void select_array_impl(int n) { }
 
 public:
+   static constexpr type_set supported_types =
+      aggregate_types | make_type_set(type::blob_string);
+
    std::list<T, Allocator> result;
 };
 
@@ -291,11 +502,17 @@ template<
    class Traits = std::char_traits<CharT>,
    class Allocator = std::allocator<CharT>
    >
-class response_verbatim_string : public response_base {
+class response_verbatim_string
+   : public response_base<response_verbatim_string<CharT, Traits, Allocator>> {
 private:
-   void on_verbatim_string_impl(std::string_view s) override
+   friend response_base<response_verbatim_string>;
+
+   void on_verbatim_string_impl(std::string_view s)
       { from_string_view(s, result); }
 public:
+   static constexpr type_set supported_types =
+      aggregate_types | make_type_set(type::verbatim_string);
+
    std::basic_string<CharT, Traits, Allocator> result;
 };
 
@@ -304,21 +521,84 @@ template<
    class Traits = std::char_traits<CharT>,
    class Allocator = std::allocator<CharT>
    >
-class response_streamed_string : public response_base {
+class response_streamed_string
+   : public response_base<response_streamed_string<CharT, Traits, Allocator>> {
 private:
-   void on_streamed_string_part_impl(std::string_view s) override
+   friend response_base<response_streamed_string>;
+
+   void on_streamed_string_part_impl(std::string_view s)
       { result += s; }
 public:
+   static constexpr type_set supported_types =
+      aggregate_types | make_type_set(type::streamed_string_part);
+
    std::basic_string<CharT, Traits, Allocator> result;
 };
 
+/* Passes the payload of a blob string to f(chunk, last) as it is read,
+ * in chunks of at most chunk_size bytes, so that large values can be
+ * written to a file or hashed with bounded memory, for example
+ *
+ *    resp::response_blob_chunks res {[&](std::string_view chunk, bool last) {
+ *       out.write(chunk.data(), std::size(chunk));
+ *    }};
+ *    co_await resp::async_read(socket, buffer, res);
+ *
+ * A null reply calls f({}, true) with null set, errors are stored in
+ * error.
+ */
+template <class F>
+class response_blob_chunks : public response_base<response_blob_chunks<F>> {
+private:
+   friend response_base<response_blob_chunks>;
+
+   F f_;
+   std::size_t chunk_size_;
+
+   void on_null_impl()
+   {
+      null = true;
+      f_({}, true);
+   }
+
+   void on_simple_error_impl(std::string_view s) { error = s; }
+   void on_blob_error_impl(std::string_view s) { error = s; }
+
+public:
+   static constexpr type_set supported_types = make_type_set(
+      type::blob_string, type::null, type::simple_error, type::blob_error);
+
+   response_blob_chunks(F f, std::size_t chunk_size = 64 * 1024)
+   : f_ {std::move(f)}
+   , chunk_size_ {chunk_size}
+   { }
+
+   std::size_t chunk_size() const noexcept
+      { return chunk_size_; }
+
+   void on_blob_string_chunk(std::string_view s, bool last)
+   {
+      size += std::size(s);
+      f_(s, last);
+   }
+
+   bool null = false;
+   std::string error;
+
+   // The number of payload bytes received.
+   std::size_t size = 0;
+};
+
 template <
    class Key,
    class Compare = std::less<Key>,
    class Allocator = std::allocator<Key>
    >
-class response_set : public response_base {
+class response_set
+   : public response_base<response_set<Key, Compare, Allocator>> {
 private:
+   friend response_base<response_set>;
+
    void add(std::string_view s)
    {
       Key r;
@@ -326,17 +606,22 @@ private:
       result.insert(std::end(result), std::move(r));
    }
 
-   void on_simple_string_impl(std::string_view s) override { add(s); }
-   void on_blob_string_impl(std::string_view s) override { add(s); }
-   void select_set_impl(int n) override { }
+   void on_simple_string_impl(std::string_view s) { add(s); }
+   void on_blob_string_impl(std::string_view s) { add(s); }
+   void select_set_impl(int n) { }
 
 public:
+   static constexpr type_set supported_types =
+      aggregate_types | make_type_set(type::simple_string, type::blob_string);
+
    std::set<Key, Compare, Allocator> result;
 };
 
-class response_bool : public response_base {
+class response_bool : public response_base<response_bool> {
 private:
-   void on_bool_impl(std::string_view s) override
+   friend response_base<response_bool>;
+
+   void on_bool_impl(std::string_view s)
    {
       if (std::ssize(s) != 1) {
 	 // We can't hadle an error in redis.
@@ -347,36 +632,48 @@ private:
    }
 
 public:
+   static constexpr type_set supported_types =
+      aggregate_types | make_type_set(type::boolean);
+
    bool result;
 };
 
 template<
    class Key,
-   class Compare = std::less<Key>,
+   class Hash = std::hash<Key>,
+   class KeyEqual = std::equal_to<Key>,
    class Allocator = std::allocator<Key>
    >
-class response_unordered_set : public response_base {
+class response_unordered_set
+   : public response_base<response_unordered_set<Key, Hash, KeyEqual, Allocator>> {
 private:
-   void on_blob_string_impl(std::string_view s) override
+   friend response_base<response_unordered_set>;
+
+   void on_blob_string_impl(std::string_view s)
    {
       Key r;
       from_string_view(s, r);
-      result.insert(std::end(result), std::move(r));
+      result.insert(std::move(r));
    }
 
-   void select_array_impl(int n) override { }
-   void select_set_impl(int n) override { }
+   void select_array_impl(int n) { reserve_more(result, n); }
+   void select_set_impl(int n) { reserve_more(result, n); }
 
 public:
-   std::set<Key, Compare, Allocator> result;
+   static constexpr type_set supported_types =
+      aggregate_types | make_type_set(type::blob_string);
+
+   std::unordered_set<Key, Hash, KeyEqual, Allocator> result;
 };
 
 template <
    class T,
    class Allocator = std::allocator<T>
    >
-class response_array : public response_base {
+class response_array : public response_base<response_array<T, Allocator>> {
 private:
+   friend response_base<response_array>;
+
    void add(std::string_view s = {})
    {
       T r;
@@ -384,20 +681,26 @@ private:
       result.emplace_back(std::move(r));
    }
 
-   void on_simple_string_impl(std::string_view s) override { add(s); }
-   void on_number_impl(std::string_view s) override { add(s); }
-   void on_double_impl(std::string_view s) override { add(s); }
-   void on_bool_impl(std::string_view s) override { add(s); }
-   void on_big_number_impl(std::string_view s) override { add(s); }
-   void on_verbatim_string_impl(std::string_view s = {}) override { add(s); }
-   void on_blob_string_impl(std::string_view s = {}) override { add(s); }
-   void select_array_impl(int n) override { }
-   void select_set_impl(int n) override { }
-   void select_map_impl(int n) override { }
-   void select_push_impl(int n) override { }
-   void on_streamed_string_part_impl(std::string_view s = {}) override { add(s); }
+   void on_simple_string_impl(std::string_view s) { add(s); }
+   void on_number_impl(std::string_view s) { add(s); }
+   void on_double_impl(std::string_view s) { add(s); }
+   void on_bool_impl(std::string_view s) { add(s); }
+   void on_big_number_impl(std::string_view s) { add(s); }
+   void on_verbatim_string_impl(std::string_view s = {}) { add(s); }
+   void on_blob_string_impl(std::string_view s = {}) { add(s); }
+   void select_array_impl(int n) { reserve_more(result, n); }
+   void select_set_impl(int n) { reserve_more(result, n); }
+   void select_map_impl(int n) { reserve_more(result, n); }
+   void select_push_impl(int n) { reserve_more(result, n); }
+   void on_streamed_string_part_impl(std::string_view s = {}) { add(s); }
 
 public:
+   static constexpr type_set supported_types =
+      aggregate_types | make_type_set(
+	 type::simple_string, type::number, type::double_type,
+	 type::boolean, type::big_number, type::verbatim_string,
+	 type::blob_string, type::streamed_string_part);
+
    std::vector<T, Allocator> result;
 };
 
@@ -408,13 +711,19 @@ template <class T, class Allocator = std::allocator<T>>
 using response_flat_set = response_array<T, Allocator>;
 
 template <class T, std::size_t N>
-class response_static_array : public response_base {
+class response_static_array
+   : public response_base<response_static_array<T, N>> {
 private:
+   friend response_base<response_static_array>;
+
    int i = 0;
-   void on_blob_string_impl(std::string_view s) override
+   void on_blob_string_impl(std::string_view s)
       { from_string_view(s, result[i++]); }
 
 public:
+   static constexpr type_set supported_types =
+      aggregate_types | make_type_set(type::blob_string);
+
    std::array<T, N> result;
 };
 
@@ -422,23 +731,169 @@ template <
    class T,
    std::size_t N
    >
-class response_static_flat_map : public response_base {
+class response_static_flat_map
+   : public response_base<response_static_flat_map<T, N>> {
 private:
+   friend response_base<response_static_flat_map>;
+
    int i = 0;
 
    void add(std::string_view s = {})
       { from_string_view(s, result.at(i++)); }
-   void on_blob_string_impl(std::string_view s) override
+   void on_blob_string_impl(std::string_view s)
       { add(s); }
-   void on_number_impl(std::string_view s) override
+   void on_number_impl(std::string_view s)
       { add(s); }
 
-   void select_push_impl(int n) override { }
+   void select_push_impl(int n) { }
 
 public:
+   static constexpr type_set supported_types =
+      aggregate_types | make_type_set(type::blob_string, type::number);
+
    std::array<T, 2 * N> result;
 };
 
+// How response_struct reads a hash that arrives as a flat array.
+enum class hash_layout
+{ pairs  // Name-value pairs, the RESP2 reply to HGETALL.
+, values // Values in the order of the fields, the reply to HMGET.
+};
+
+/* Decodes a hash into the struct T, whose fields are described by a
+ * specialization of struct_fields. The reply to HGETALL is matched by
+ * field name, unknown names are ignored. The reply to HMGET is taken
+ * in the declaration order of the fields, see field_names, and nulls
+ * leave the field unchanged. Members are assigned with
+ * from_string_view, so reusing the response reuses their storage.
+ * result is not reset between replies either, fields that are null or
+ * absent in a reply keep the value of the previous one. Assign
+ * result = T {} before reading if that is not wanted.
+ *
+ * A RESP3 map is always read as name-value pairs. An array can't be
+ * told apart, so the layout given on construction decides, that is
+ * hash_layout::pairs for HGETALL on RESP2 connections.
+ */
+template <class T>
+class response_struct : public response_base<response_struct<T>> {
+private:
+   friend response_base<response_struct>;
+
+   using setter = void (*)(T&, std::string_view);
+
+   template <std::size_t... Is>
+   static constexpr auto make_setters(std::index_sequence<Is...>)
+   {
+      return std::array<setter, sizeof...(Is)> {
+	 [](T& obj, std::string_view s) {
+	    from_string_view(s, obj.*(std::get<Is>(struct_fields<T>::value).member));
+	 }...
+      };
+   }
+
+   static constexpr auto setters =
+      make_setters(std::make_index_sequence<field_count<T>> {});
+
+   // Whether arrays hold name-value pairs.
+   hash_layout layout_;
+
+   // Whether the reply has name-value pairs or values only.
+   bool pairs_ = false;
+   bool name_ = true;
+
+   // The field of the next value or -1 to ignore it.
+   int i_ = 0;
+
+   void select_map_impl(int n)
+      { pairs_ = true; name_ = true; }
+
+   void select_array_impl(int n)
+      { pairs_ = layout_ == hash_layout::pairs; name_ = true; i_ = 0; }
+
+   void on_blob_string_impl(std::string_view s)
+   {
+      if (pairs_ && name_) {
+	 i_ = field_index<T>(s);
+	 name_ = false;
+	 return;
+      }
+
+      if (i_ >= 0 && i_ < std::ssize(setters))
+	 setters[i_](result, s);
+
+      if (pairs_)
+	 name_ = true;
+      else
+	 ++i_;
+   }
+
+   void on_null_impl()
+   {
+      if (!pairs_) {
+	 ++i_;
+	 return;
+      }
+
+      // The value of a null name is ignored.
+      if (name_)
+	 i_ = -1;
+      name_ = !name_;
+   }
+
+public:
+   static constexpr type_set supported_types =
+      aggregate_types | make_type_set(type::blob_string, type::null);
+
+   T result;
+
+   explicit response_struct(hash_layout layout = hash_layout::values)
+   : layout_ {layout}
+   { }
+};
+
+// Counts the acknowledgements of commands sent inside a transaction,
+// +OK for MULTI and +QUEUED for the others, and keeps the first error
+// with the position of the acknowledgement it replaced.
+class response_acks : public response_base<response_acks> {
+private:
+   friend response_base<response_acks>;
+
+   void on_simple_string_impl(std::string_view)
+      { ++count; }
+
+   void on_error(std::string_view s, type t)
+   {
+      if (errors++ == 0) {
+	 error = s;
+	 error_type = t;
+	 error_index = count;
+      }
+      ++count;
+   }
+
+   void on_simple_error_impl(std::string_view s) { on_error(s, type::simple_error); }
+   void on_blob_error_impl(std::string_view s) { on_error(s, type::blob_error); }
+
+public:
+   static constexpr type_set supported_types =
+      make_type_set(type::simple_string, type::simple_error, type::blob_error);
+
+   std::size_t count = 0;
+   std::size_t errors = 0;
+   std::string error;
+   type error_type = type::invalid;
+   std::size_t error_index = 0;
+
+   void clear()
+   {
+      count = 0;
+      errors = 0;
+      error.clear();
+      error_type = type::invalid;
+      error_index = 0;
+   }
+};
+
 template <class Event>
 struct response_id {
    command cmd;
@@ -451,6 +906,8 @@ struct responses {
    response_simple_string<char> simple_string;
    response_array<std::string> array;
    response_general general;
+   response_acks acks;
+   response_transaction transaction;
 };
 
 } // resp
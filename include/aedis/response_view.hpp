@@ -0,0 +1,112 @@
+/* Copyright (c) 2019 - 2021 Marcelo Zimbres Silva (mzimbres at gmail dot com)
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <string_view>
+
+#include "response.hpp"
+
+namespace aedis { namespace resp {
+
+/* Responses that store views into the read buffer instead of copies.
+ * The read functions pin the read_buffer blocks the views point into
+ * so they remain valid for as long as the response is alive or until
+ * clear is called, for example
+ *
+ *    resp::read_buffer buffer;
+ *    resp::response_view_array res;
+ *    co_await resp::async_read(socket, buffer, res);
+ *
+ * They require a read_buffer as storage. Pinned blocks are not reused
+ * by the buffer, keeping many responses alive therefore retains the
+ * memory of the reads they were parsed from.
+ */
+template <class Derived>
+class response_view_base : public response_base<Derived> {
+private:
+   std::vector<std::shared_ptr<char const[]>> segments_;
+
+public:
+   void pin(std::shared_ptr<char const[]> s)
+   {
+      if (s && (std::empty(segments_) || segments_.back() != s))
+	 segments_.push_back(std::move(s));
+   }
+
+   // Releases the pinned blocks, views become invalid.
+   void release() noexcept
+      { segments_.clear(); }
+};
+
+class response_view_blob_string
+   : public response_view_base<response_view_blob_string> {
+private:
+   friend response_base<response_view_blob_string>;
+
+   void on_blob_string_impl(std::string_view s)
+      { result = s; }
+   void on_blob_error_impl(std::string_view s)
+      { result = s; }
+   void on_simple_string_impl(std::string_view s)
+      { result = s; }
+   void on_simple_error_impl(std::string_view s)
+      { result = s; }
+
+public:
+   static constexpr type_set supported_types =
+      aggregate_types | make_type_set(
+	 type::blob_string, type::blob_error,
+	 type::simple_string, type::simple_error);
+
+   std::string_view result;
+
+   void clear()
+      { result = {}; release(); }
+};
+
+class response_view_array
+   : public response_view_base<response_view_array> {
+private:
+   friend response_base<response_view_array>;
+
+   void add(std::string_view s = {})
+      { result.push_back(s); }
+
+   void on_simple_string_impl(std::string_view s) { add(s); }
+   void on_number_impl(std::string_view s) { add(s); }
+   void on_double_impl(std::string_view s) { add(s); }
+   void on_bool_impl(std::string_view s) { add(s); }
+   void on_big_number_impl(std::string_view s) { add(s); }
+   void on_verbatim_string_impl(std::string_view s = {}) { add(s); }
+   void on_blob_string_impl(std::string_view s = {}) { add(s); }
+   void select_array_impl(int n) { reserve_more(result, n); }
+   void select_set_impl(int n) { reserve_more(result, n); }
+   void select_map_impl(int n) { reserve_more(result, n); }
+   void select_push_impl(int n) { reserve_more(result, n); }
+   void on_streamed_string_part_impl(std::string_view s = {}) { add(s); }
+
+public:
+   static constexpr type_set supported_types =
+      aggregate_types | make_type_set(
+	 type::simple_string, type::number, type::double_type,
+	 type::boolean, type::big_number, type::verbatim_string,
+	 type::blob_string, type::streamed_string_part);
+
+   std::vector<std::string_view> result;
+
+   void clear()
+      { result.clear(); release(); }
+};
+
+using response_view_flat_map = response_view_array;
+using response_view_flat_set = response_view_array;
+
+} // resp
+} // aedis
@@ -0,0 +1,93 @@
+/* Copyright (c) 2019 - 2021 Marcelo Zimbres Silva (mzimbres at gmail dot com)
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#pragma once
+
+#include <vector>
+#include <cassert>
+#include <utility>
+
+namespace aedis { namespace resp {
+
+/* A fifo queue stored in a contiguous ring buffer. Unlike std::queue
+ * it does not allocate once it reached its largest size, and clear
+ * keeps the capacity. Popped elements are assigned a default
+ * constructed value so that they release their resources.
+ */
+template <class T>
+class ring_queue {
+private:
+   std::vector<T> buffer_;
+   std::size_t head_ = 0;
+   std::size_t size_ = 0;
+
+   // The capacity is a power of two so that indexes wrap with a mask.
+   std::size_t mask() const noexcept
+      { return std::size(buffer_) - 1; }
+
+   void grow()
+   {
+      std::vector<T> tmp(std::empty(buffer_) ? 8 : 2 * std::size(buffer_));
+      for (std::size_t i = 0; i < size_; ++i)
+	 tmp[i] = std::move((*this)[i]);
+      buffer_ = std::move(tmp);
+      head_ = 0;
+   }
+
+public:
+   using value_type = T;
+
+   auto size() const noexcept { return size_; }
+   bool empty() const noexcept { return size_ == 0; }
+   auto capacity() const noexcept { return std::size(buffer_); }
+
+   // The i-th element counting from the front.
+   T& operator[](std::size_t i) noexcept
+      { return buffer_[(head_ + i) & mask()]; }
+   T const& operator[](std::size_t i) const noexcept
+      { return buffer_[(head_ + i) & mask()]; }
+
+   T& front() noexcept { assert(size_ != 0); return (*this)[0]; }
+   T const& front() const noexcept { assert(size_ != 0); return (*this)[0]; }
+   T& back() noexcept { assert(size_ != 0); return (*this)[size_ - 1]; }
+   T const& back() const noexcept { assert(size_ != 0); return (*this)[size_ - 1]; }
+
+   template <class... Args>
+   T& emplace(Args&&... args)
+   {
+      if (size_ == std::size(buffer_))
+	 grow();
+
+      auto& slot = (*this)[size_];
+      slot = T(std::forward<Args>(args)...);
+      ++size_;
+      return slot;
+   }
+
+   void push(T const& v) { emplace(v); }
+   void push(T&& v) { emplace(std::move(v)); }
+
+   void pop()
+   {
+      assert(size_ != 0);
+      front() = T {};
+      head_ = (head_ + 1) & mask();
+      // Restarting at the beginning keeps the elements contiguous when
+      // the queue is drained often.
+      if (--size_ == 0)
+	 head_ = 0;
+   }
+
+   void clear()
+   {
+      while (!empty())
+	 pop();
+   }
+};
+
+} // resp
+} // aedis
@@ -0,0 +1,252 @@
+/* Copyright (c) 2019 - 2021 Marcelo Zimbres Silva (mzimbres at gmail dot com)
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#pragma once
+
+#include <array>
+#include <string>
+#include <cstring>
+#include <algorithm>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#  define AEDIS_SCANNER_X86 1
+#  include <immintrin.h>
+#endif
+
+namespace aedis { namespace resp {
+
+/* Stage-1 scanners. They look for every "\r\n" whose '\r' is at an
+ * offset in [begin, n - 1), write the offsets of the '\r' in out and
+ * return the offset up to which the data has been scanned. Scanning
+ * stops early when max offsets have been found.
+ */
+using scan_function =
+   std::size_t (*)( char const* data
+                  , std::size_t begin
+                  , std::size_t n
+                  , std::size_t* out
+                  , std::size_t& count
+                  , std::size_t max);
+
+inline
+std::size_t
+scan_separators_scalar(
+   char const* data,
+   std::size_t begin,
+   std::size_t n,
+   std::size_t* out,
+   std::size_t& count,
+   std::size_t max)
+{
+   count = 0;
+   if (n < 2 || begin >= n - 1)
+      return begin;
+
+   auto const last = n - 1;
+   while (begin < last) {
+      auto const* p =
+	 static_cast<char const*>(std::memchr(data + begin, '\r', last - begin));
+      if (!p)
+	 return last;
+
+      begin = p - data;
+      if (data[begin + 1] == '\n') {
+	 out[count++] = begin;
+	 if (count == max)
+	    return begin + 1;
+      }
+
+      ++begin;
+   }
+
+   return last;
+}
+
+#ifdef AEDIS_SCANNER_X86
+
+// Records the bits set in mask as offsets relative to i. Returns true
+// when the output is full.
+inline
+bool
+add_separators(
+   unsigned mask,
+   std::size_t i,
+   std::size_t* out,
+   std::size_t& count,
+   std::size_t max)
+{
+   while (mask != 0) {
+      out[count++] = i + __builtin_ctz(mask);
+      if (count == max)
+	 return true;
+      mask &= mask - 1;
+   }
+
+   return false;
+}
+
+__attribute__((target("sse2")))
+inline
+std::size_t
+scan_separators_sse2(
+   char const* data,
+   std::size_t begin,
+   std::size_t n,
+   std::size_t* out,
+   std::size_t& count,
+   std::size_t max)
+{
+   count = 0;
+   auto const cr = _mm_set1_epi8('\r');
+   auto const lf = _mm_set1_epi8('\n');
+
+   // Each iteration reads 17 bytes, the last one for the '\n'.
+   auto i = begin;
+   for (; i + 16 < n; i += 16) {
+      auto const a = _mm_loadu_si128(reinterpret_cast<__m128i const*>(data + i));
+      auto const b = _mm_loadu_si128(reinterpret_cast<__m128i const*>(data + i + 1));
+      auto const m =
+	 _mm_and_si128(_mm_cmpeq_epi8(a, cr), _mm_cmpeq_epi8(b, lf));
+      auto const mask = static_cast<unsigned>(_mm_movemask_epi8(m));
+      if (add_separators(mask, i, out, count, max))
+	 return out[count - 1] + 1;
+   }
+
+   std::size_t c = 0;
+   auto const ret = scan_separators_scalar(data, i, n, out + count, c, max - count);
+   count += c;
+   return ret;
+}
+
+__attribute__((target("avx2")))
+inline
+std::size_t
+scan_separators_avx2(
+   char const* data,
+   std::size_t begin,
+   std::size_t n,
+   std::size_t* out,
+   std::size_t& count,
+   std::size_t max)
+{
+   count = 0;
+   auto const cr = _mm256_set1_epi8('\r');
+   auto const lf = _mm256_set1_epi8('\n');
+
+   // Each iteration reads 33 bytes, the last one for the '\n'.
+   auto i = begin;
+   for (; i + 32 < n; i += 32) {
+      auto const a = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(data + i));
+      auto const b = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(data + i + 1));
+      auto const m =
+	 _mm256_and_si256(_mm256_cmpeq_epi8(a, cr), _mm256_cmpeq_epi8(b, lf));
+      auto const mask = static_cast<unsigned>(_mm256_movemask_epi8(m));
+      if (add_separators(mask, i, out, count, max))
+	 return out[count - 1] + 1;
+   }
+
+   std::size_t c = 0;
+   auto const ret = scan_separators_scalar(data, i, n, out + count, c, max - count);
+   count += c;
+   return ret;
+}
+
+#endif // AEDIS_SCANNER_X86
+
+// Picks the best scanner supported by the cpu.
+inline
+scan_function select_scanner() noexcept
+{
+#ifdef AEDIS_SCANNER_X86
+   __builtin_cpu_init();
+   if (__builtin_cpu_supports("avx2"))
+      return scan_separators_avx2;
+   if (__builtin_cpu_supports("sse2"))
+      return scan_separators_sse2;
+#endif
+   return scan_separators_scalar;
+}
+
+inline
+std::size_t
+scan_separators(
+   char const* data,
+   std::size_t begin,
+   std::size_t n,
+   std::size_t* out,
+   std::size_t& count,
+   std::size_t max)
+{
+   static scan_function const f = select_scanner();
+   return f(data, begin, n, out, count, max);
+}
+
+/* Indexes the "\r\n" separators of the data received from the stream
+ * so that each byte is scanned only once, regardless of how many
+ * elements are parsed from a block. Offsets are kept relative to the
+ * beginning of the stream so that consuming data does not require
+ * updating the index.
+ */
+class separator_index {
+public:
+   static std::size_t constexpr npos = std::string::npos;
+
+private:
+   static std::size_t constexpr capacity = 64;
+
+   std::array<std::size_t, capacity> seps_;
+   std::size_t head_ = 0;
+   std::size_t tail_ = 0;
+
+   // Separators looked for on the next scan. It starts small so that
+   // reading short replies does not scan far ahead of what they use.
+   std::size_t batch_ = 2;
+
+   // Stream offset of the first unconsumed byte.
+   std::size_t base_ = 0;
+
+   // Stream offset up to which the data has been indexed.
+   std::size_t scanned_ = 0;
+
+public:
+   // Returns the offset of the next separator in [data, data + n) or
+   // npos, where data points to the first unconsumed byte.
+   std::size_t find(char const* data, std::size_t n)
+   {
+      // Separators that were part of a bulk payload are skipped.
+      while (head_ != tail_ && seps_[head_] < base_)
+	 ++head_;
+
+      if (head_ == tail_) {
+	 auto const begin = std::max(scanned_, base_) - base_;
+	 std::size_t count = 0;
+	 auto const end =
+	    scan_separators(data, begin, n, std::data(seps_), count, batch_);
+
+	 batch_ = std::min(2 * batch_, capacity);
+
+	 for (std::size_t i = 0; i < count; ++i)
+	    seps_[i] += base_;
+
+	 head_ = 0;
+	 tail_ = count;
+	 scanned_ = base_ + end;
+      }
+
+      if (head_ == tail_)
+	 return npos;
+
+      return seps_[head_] - base_;
+   }
+
+   // Informs the index that n bytes have been consumed from the front.
+   void consume(std::size_t n) noexcept
+      { base_ += n; }
+};
+
+} // resp
+} // aedis
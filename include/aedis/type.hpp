@@ -7,6 +7,10 @@
 
 #pragma once
 
+#include <array>
+#include <cstdint>
+#include <cassert>
+
 namespace aedis { namespace resp {
 
 enum class type
@@ -56,29 +60,55 @@ auto to_string(type t)
    }
 }
 
+// Maps the first byte of a RESP3 element to its type.
 inline
-auto to_type(char c)
+constexpr auto make_type_table()
 {
-   switch (c) {
-      case '!': return type::blob_error;
-      case '=': return type::verbatim_string;
-      case '$': return type::blob_string;
-      case ';': return type::streamed_string_part;
-      case '-': return type::simple_error;
-      case ':': return type::number;
-      case ',': return type::double_type;
-      case '#': return type::boolean;
-      case '(': return type::big_number;
-      case '+': return type::simple_string;
-      case '_': return type::null;
-      case '>': return type::push;
-      case '~': return type::set;
-      case '*': return type::array;
-      case '|': return type::attribute;
-      case '%': return type::map;
-      default: return type::invalid;
-   }
+   std::array<type, 256> t {};
+   for (auto& e : t)
+      e = type::invalid;
+
+   t['!'] = type::blob_error;
+   t['='] = type::verbatim_string;
+   t['$'] = type::blob_string;
+   t[';'] = type::streamed_string_part;
+   t['-'] = type::simple_error;
+   t[':'] = type::number;
+   t[','] = type::double_type;
+   t['#'] = type::boolean;
+   t['('] = type::big_number;
+   t['+'] = type::simple_string;
+   t['_'] = type::null;
+   t['>'] = type::push;
+   t['~'] = type::set;
+   t['*'] = type::array;
+   t['|'] = type::attribute;
+   t['%'] = type::map;
+   return t;
 }
 
+inline constexpr auto type_table = make_type_table();
+
+inline
+constexpr auto to_type(char c) noexcept
+   { return type_table[static_cast<unsigned char>(c)]; }
+
+// A set of types as a bit mask, used by responses to declare which
+// types they are able to handle.
+using type_set = std::uint32_t;
+
+template <class... Ts>
+constexpr type_set make_type_set(Ts... ts) noexcept
+   { return ((type_set {1} << static_cast<int>(ts)) | ... | 0); }
+
+inline constexpr type_set all_types =
+   (type_set {1} << static_cast<int>(type::invalid)) - 1;
+
+inline constexpr type_set aggregate_types =
+   make_type_set(type::array, type::push, type::set, type::map, type::attribute);
+
+constexpr bool contains(type_set s, type t) noexcept
+   { return (s & make_type_set(t)) != 0; }
+
 } // resp
 } // aedis
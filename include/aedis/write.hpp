@@ -9,6 +9,7 @@
 
 #include <queue>
 #include <chrono>
+#include <vector>
 
 #include <boost/asio.hpp>
 #include <boost/beast/core/stream_traits.hpp>
@@ -17,6 +18,27 @@
 
 namespace aedis { namespace resp {
 
+/* The buffers of a request: slices of the payload interleaved with the
+ * values it refers to, see value_ref. They are written with a single
+ * gathered write.
+ */
+template <class Event>
+std::vector<net::const_buffer> buffers(request<Event> const& req)
+{
+   std::vector<net::const_buffer> ret;
+   ret.reserve(2 * std::size(req.segments()) + 1);
+
+   std::size_t offset = 0;
+   for (auto const& s : req.segments()) {
+      ret.push_back(net::buffer(req.payload.data() + offset, s.offset - offset));
+      ret.push_back(net::buffer(s.data));
+      offset = s.offset;
+   }
+
+   ret.push_back(net::buffer(req.payload.data() + offset, std::size(req.payload) - offset));
+   return ret;
+}
+
 template<
    class SyncWriteStream,
    class Event>
@@ -29,7 +51,10 @@ write(
     static_assert(boost::beast::is_sync_write_stream<SyncWriteStream>::value,
         "SyncWriteStream type requirements not met");
 
-    return write(stream, net::buffer(req.payload), ec);
+    if (std::empty(req.segments()))
+       return write(stream, net::buffer(req.payload), ec);
+
+    return write(stream, buffers(req), ec);
 }
 
 template<
@@ -68,7 +93,10 @@ async_write(
       AsyncWriteStream>::value,
       "AsyncWriteStream type requirements not met");
 
-   return net::async_write(stream, net::buffer(req.payload), token);
+   if (std::empty(req.segments()))
+      return net::async_write(stream, net::buffer(req.payload), token);
+
+   return net::async_write(stream, buffers(req), token);
 }
 
 }
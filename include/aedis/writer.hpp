@@ -0,0 +1,141 @@
+/* Copyright (c) 2019 - 2021 Marcelo Zimbres Silva (mzimbres at gmail dot com)
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <utility>
+
+#include <boost/asio.hpp>
+
+#include "request.hpp"
+#include "write.hpp"
+
+namespace aedis { namespace resp {
+
+/* Coalesces the commands enqueued by any number of coroutines into as
+ * few writes as possible. Commands enqueued while the writer is idle
+ * or busy writing are sent together in the next write, for example
+ *
+ *    resp::coalescing_writer<tcp_socket> w {socket};
+ *    co_spawn(ex, w.run([](auto& req) { }), net::detached);
+ *    ...
+ *    w.enqueue([](auto& req) { req.get("key"); });
+ *
+ * Everything enqueued during one turn of the event loop ends up in the
+ * same write. With a window the writer additionally waits that long
+ * for more commands, unless max_bytes are pending.
+ */
+template <class AsyncWriteStream, class Event = event>
+class coalescing_writer {
+public:
+   struct config {
+      std::chrono::microseconds window {0};
+      std::size_t max_bytes = 64 * 1024;
+   };
+
+private:
+   AsyncWriteStream& stream_;
+   config cfg_;
+   net::steady_timer timer_;
+
+   // Commands are enqueued in pending_ while writing_ is being
+   // written, both are reused.
+   request<Event> pending_;
+   request<Event> writing_;
+
+   bool in_window_ = false;
+   bool closed_ = false;
+   std::size_t writes_ = 0;
+
+   net::awaitable<void> wait()
+   {
+      boost::system::error_code ec;
+      co_await timer_.async_wait(net::redirect_error(net::use_awaitable, ec));
+   }
+
+public:
+   coalescing_writer(AsyncWriteStream& stream, config cfg = {})
+   : stream_ {stream}
+   , cfg_ {cfg}
+   , timer_ {stream.get_executor()}
+   { }
+
+   // Calls f with the request the next write is assembled in.
+   template <class F>
+   void enqueue(F f)
+   {
+      auto const idle = std::empty(pending_);
+      f(pending_);
+
+      // Cancelling the timer wakes the writer up, either when it waits
+      // for the first command or when the window is full.
+      if ((idle && !in_window_) ||
+	  (in_window_ && std::size(pending_.payload) >= cfg_.max_bytes))
+	 timer_.cancel();
+   }
+
+   // Stops run once the pending commands have been written.
+   void close()
+   {
+      closed_ = true;
+      timer_.cancel();
+   }
+
+   auto writes() const noexcept { return writes_; }
+   auto const& pending() const noexcept { return pending_; }
+
+   // Wakes run up to check the ready predicate again.
+   void notify()
+      { timer_.cancel(); }
+
+   /* Writes the enqueued commands until close is called. Before each
+    * write on_write is called with the request about to be written, it
+    * may take its events, the request is cleared afterwards. Nothing is
+    * written while ready returns false, see notify.
+    */
+   template <class F, class Ready>
+   net::awaitable<void> run(F on_write, Ready ready)
+   {
+      for (;;) {
+	 if (std::empty(pending_)) {
+	    if (closed_)
+	       co_return;
+
+	    timer_.expires_at(net::steady_timer::time_point::max());
+	    co_await wait();
+	    continue;
+	 }
+
+	 if (!closed_ && !ready()) {
+	    timer_.expires_at(net::steady_timer::time_point::max());
+	    co_await wait();
+	    continue;
+	 }
+
+	 if (!closed_ && cfg_.window.count() > 0 && std::size(pending_.payload) < cfg_.max_bytes) {
+	    in_window_ = true;
+	    timer_.expires_after(cfg_.window);
+	    co_await wait();
+	    in_window_ = false;
+	 }
+
+	 std::swap(pending_, writing_);
+	 on_write(writing_);
+	 co_await resp::async_write(stream_, writing_, net::use_awaitable);
+	 ++writes_;
+	 writing_.clear();
+      }
+   }
+
+   template <class F>
+   net::awaitable<void> run(F on_write)
+      { return run(std::move(on_write), []() { return true; }); }
+};
+
+} // resp
+} // aedis
@@ -0,0 +1,100 @@
+/* Copyright (c) 2019 - 2021 Marcelo Zimbres Silva (mzimbres at gmail dot com)
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#include <new>
+#include <string>
+#include <cstddef>
+#include <cstdlib>
+#include <iostream>
+#include <algorithm>
+
+#include <aedis/aedis.hpp>
+
+// Tests that count heap allocations. They replace the global operator
+// new and are kept in their own executable so that the other tests
+// are not affected.
+
+using namespace aedis;
+
+// Calls to the global operator new. Every replaceable form is defined
+// so that all memory released with std::free comes from here.
+static std::size_t allocations = 0;
+
+static void* counted_alloc(std::size_t n, std::size_t align = alignof(std::max_align_t))
+{
+   ++allocations;
+   n = std::max<std::size_t>(n, 1);
+   auto* p = align <= alignof(std::max_align_t)
+      ? std::malloc(n)
+      : std::aligned_alloc(align, (n + align - 1) / align * align);
+   if (!p)
+      throw std::bad_alloc {};
+   return p;
+}
+
+void* operator new(std::size_t n) { return counted_alloc(n); }
+void* operator new[](std::size_t n) { return counted_alloc(n); }
+void* operator new(std::size_t n, std::align_val_t a) { return counted_alloc(n, static_cast<std::size_t>(a)); }
+void* operator new[](std::size_t n, std::align_val_t a) { return counted_alloc(n, static_cast<std::size_t>(a)); }
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+void operator delete(void* p, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::align_val_t) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t, std::align_val_t) noexcept { std::free(p); }
+
+template <class T>
+void check_equal(T const& a, T const& b, std::string const& msg = "")
+{
+   if (a == b)
+     std::cout << "Success: " << msg << std::endl;
+   else
+     std::cout << "Error: " << msg << std::endl;
+}
+
+void pool()
+{
+   std::string const big(10000, 'x');
+   resp::request_pool<> pool;
+   resp::prepared const incr {resp::command::hincrby, "HINCRBY", resp::slot, "visits", 1};
+
+   // Fills the payload, the events and the value segments, then
+   // recycles the request as if its responses had been read.
+   auto submit = [&]() {
+      auto req = pool.get();
+      for (auto i = 0; i < 100; ++i) {
+	 req.get("key");
+	 req.lrange("list", 0, i);
+	 incr.append(req, "user:1");
+	 req.set("big", resp::borrow(big));
+      }
+      req.ping();
+
+      while (!std::empty(req.events))
+	 req.events.pop();
+
+      pool.recycle(std::move(req));
+   };
+
+   // Recycled requests keep their capacity, after the first one no
+   // allocation is needed.
+   submit();
+   allocations = 0;
+   for (auto i = 0; i < 10; ++i)
+      submit();
+   auto const n = allocations;
+   check_equal(n, std::size_t {0}, "pool (steady state)");
+   check_equal(pool.size(), std::size_t {1}, "pool (size)");
+}
+
+int main()
+{
+   pool();
+}
@@ -12,8 +12,8 @@ namespace aedis {
 struct initiate_async_receive {
    using executor_type = aedis::net::system_executor;
 
-   std::string::const_iterator pbegin;
-   std::string::const_iterator pend;
+   std::string const* payload;
+   std::size_t* pos;
 
    executor_type get_executor() noexcept
       { return aedis::net::system_executor(); }
@@ -35,6 +35,10 @@ struct initiate_async_receive {
       auto end = boost::asio::buffer_sequence_end(buffers);
       //std::cout << "Buffers size: " << std::size(buffers) << std::endl;
 
+      // Subsequent reads continue from where the last one stopped.
+      auto pbegin = std::cbegin(*payload) + *pos;
+      auto const pend = std::cend(*payload);
+
       std::size_t transferred = 0;
       while (begin != end) {
         //std::cout << "Buffer size: " << std::ssize(*begin) << std::endl;
@@ -45,6 +49,8 @@ struct initiate_async_receive {
         ++begin;
       }
 
+      *pos += transferred;
+
       handler(ec, transferred);
    }
 };
@@ -52,6 +58,7 @@ struct initiate_async_receive {
 template <class Executor>
 struct test_stream {
    std::string payload;
+   std::size_t pos = 0;
 
    using executor_type = Executor;
 
@@ -66,8 +73,7 @@ struct test_stream {
     {
       return aedis::net::async_initiate<ReadHandler,
         void (boost::system::error_code, std::size_t)>(
-          initiate_async_receive
-          {std::cbegin(payload), std::cend(payload)},
+          initiate_async_receive {&payload, &pos},
            handler, buffers);
     }
 